@@ -71,6 +71,15 @@ private:
         defaultSettings["app.version"] = "0.0.2";//版本信息
         defaultSettings["ffmpeg.path"] = "ffmpeg";//ffmpeg路径
         defaultSettings["isExecutionConfirmed"] = "true";//执行确认
+        defaultSettings["cgroup.enabled"] = "false";//为每个ffmpeg任务建立cgroup v2子组（仅Linux）
+        defaultSettings["cgroup.parent"] = "";//已委派的父cgroup目录，空表示当前cgroup
+        defaultSettings["cgroup.move_self"] = "false";//cgroup.parent为空时是否把整个程序永久移入当前cgroup下的convenient-cf-self子组，以便启用控制器
+        defaultSettings["cgroup.cpu_cores"] = "0";//CPU上限（核数），0表示不限制
+        defaultSettings["cgroup.memory_max"] = "";//memory.max，如2G
+        defaultSettings["cgroup.memory_high"] = "";//memory.high
+        defaultSettings["cgroup.io_max"] = "";//io.max，如"8:0 rbps=104857600"，多个设备用;分隔
+        defaultSettings["batch.workers"] = "0";//批量转换同时运行的任务数，0表示CPU核数的一半
+        defaultSettings["batch.adaptive"] = "true";//按PSI和平均负载在1到batch.workers之间调整并发数（仅Linux）
     }
 
 public:
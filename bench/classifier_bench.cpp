@@ -0,0 +1,158 @@
+/**
+ * classifier_bench.cpp
+ * 输出行分类基准：对比旧的逐关键词 toLower + find 检测与 OutputClassifier 单次扫描
+ * 同时逐行校验两者的分类结果一致
+ *
+ * 编译：g++ -std=c++17 -O2 -I.. classifier_bench.cpp -o classifier_bench
+ * 运行：./classifier_bench [日志文件...]   （不指定文件时使用内置样例）
+ */
+
+#include "ffmpeg_executor.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * 旧实现的检测逻辑
+ */
+namespace legacy {
+
+std::string toLower(const std::string& str) {
+    std::string result = str;
+    std::transform(result.begin(), result.end(), result.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return result;
+}
+
+bool detectOverwritePrompt(const std::string& line) {
+    std::string line_lower = toLower(line);
+    if (line_lower.find("already exists") != std::string::npos &&
+        line_lower.find("overwrite") != std::string::npos) {
+        return true;
+    }
+    if (line_lower.find("overwrite?") != std::string::npos ||
+        line_lower.find("overwrite (y/n)") != std::string::npos) {
+        return true;
+    }
+    return line.find("已存在") != std::string::npos && line.find("覆盖") != std::string::npos;
+}
+
+bool detectError(const std::string& line) {
+    std::string line_lower = toLower(line);
+    std::vector<std::string> error_keywords = {
+        "error", "failed", "invalid", "unable", "cannot",
+        "unknown", "not found", "permission denied", "access denied"
+    };
+    for (const auto& keyword : error_keywords) {
+        if (line_lower.find(keyword) != std::string::npos) {
+            if (line_lower.find("non-monotonous") != std::string::npos) {
+                continue;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+bool detectSuccess(const std::string& line) {
+    std::string line_lower = toLower(line);
+    if (line_lower.find("video:") != std::string::npos &&
+        line_lower.find("audio:") != std::string::npos &&
+        line_lower.find("subtitle:") != std::string::npos) {
+        return true;
+    }
+    return line_lower.find("muxing overhead") != std::string::npos;
+}
+
+unsigned classify(const std::string& line) {
+    unsigned result = 0;
+    if (detectOverwritePrompt(line)) {
+        result |= OutputClassifier::kOverwritePrompt;
+    }
+    if (detectError(line)) {
+        result |= OutputClassifier::kError;
+    }
+    if (detectSuccess(line)) {
+        result |= OutputClassifier::kSuccess;
+    }
+    return result;
+}
+
+} // namespace legacy
+
+static const char* kBuiltinSample =
+    "ffmpeg version 6.1.1 Copyright (c) 2000-2023 the FFmpeg developers\n"
+    "Input #0, matroska,webm, from 'input.mkv':\n"
+    "  Duration: 00:42:10.03, start: 0.000000, bitrate: 6120 kb/s\n"
+    "  Stream #0:0: Video: h264 (High), yuv420p(tv, bt709, progressive), 1920x1080, 23.98 fps\n"
+    "  Stream #0:1(eng): Audio: aac (LC), 48000 Hz, stereo, fltp (default)\n"
+    "File 'output.mp4' already exists. Overwrite? [y/N] y\n"
+    "Stream mapping:\n"
+    "  Stream #0:0 -> #0:0 (h264 (native) -> h264 (libx264))\n"
+    "[libx264 @ 0x5581b2c0] using cpu capabilities: MMX2 SSE2Fast SSSE3 SSE4.2 AVX FMA3 BMI2 AVX2\n"
+    "[mp4 @ 0x5581c400] Application provided invalid, non monotonically increasing dts to muxer\n"
+    "[matroska,webm @ 0x5581a000] non-monotonous DTS in output stream 0:1; previous: 4512, current: 4500\n"
+    "[h264 @ 0x5581d0c0] error while decoding MB 12 40, bytestream -5\n"
+    "frame= 1024 fps= 96 q=28.0 size=    8192kB time=00:00:42.70 bitrate=1571.6kbits/s speed=3.98x\n"
+    "video:60210kB audio:10240kB subtitle:0kB other streams:0kB global headers:0kB muxing overhead: 0.211%\n";
+
+static std::vector<std::string> loadLines(int argc, char** argv) {
+    std::string text;
+    if (argc <= 1) {
+        text = kBuiltinSample;
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::ifstream file(argv[i], std::ios::binary);
+        std::stringstream ss;
+        ss << file.rdbuf();
+        text += ss.str();
+    }
+    std::vector<std::string> lines;
+    LineFramer framer;
+    framer.append(text.data(), text.size());
+    framer.drain([&](std::string_view line, bool) { lines.emplace_back(line); });
+    framer.finish([&](std::string_view line, bool) { lines.emplace_back(line); });
+    return lines;
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> lines = loadLines(argc, argv);
+    const OutputClassifier& classifier = OutputClassifier::instance();
+
+    size_t mismatches = 0;
+    for (const auto& line : lines) {
+        if (legacy::classify(line) != classifier.classify(line)) {
+            mismatches++;
+            printf("mismatch: %s\n", line.c_str());
+        }
+    }
+
+    // 重复到至少一百万行以获得稳定的计时
+    size_t rounds = std::max<size_t>(1, 1000000 / std::max<size_t>(1, lines.size()));
+    unsigned sink = 0;
+    auto start = Clock::now();
+    for (size_t r = 0; r < rounds; ++r) {
+        for (const auto& line : lines) {
+            sink += legacy::classify(line);
+        }
+    }
+    double legacy_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+    start = Clock::now();
+    for (size_t r = 0; r < rounds; ++r) {
+        for (const auto& line : lines) {
+            sink += classifier.classify(line);
+        }
+    }
+    double matcher_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+    size_t total = rounds * lines.size();
+    printf("lines=%zu rounds=%zu mismatches=%zu\n", lines.size(), rounds, mismatches);
+    printf("legacy detectors   %8.1f ns/line\n", legacy_ns / total);
+    printf("OutputClassifier   %8.1f ns/line   (%.1fx)\n", matcher_ns / total, legacy_ns / matcher_ns);
+    return (mismatches == 0 && sink != 1) ? 0 : 1;
+}
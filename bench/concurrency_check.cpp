@@ -0,0 +1,166 @@
+/**
+ * concurrency_check.cpp
+ * ConcurrencyController 的校验程序：在临时目录中伪造 /proc/pressure 和 /proc/loadavg，
+ * 按一串合成的负载样本驱动控制器，检查每一步之后池的并发数上限
+ * 检查项：读不到负载时保持上限、低负载且有排队时逐步增加、超过上阈值时减少、上下阈值之间不变（滞回）、
+ *         冷却期内不连续调整、不超出上下限、没有排队的任务时不增加
+ *
+ * 编译：g++ -std=c++17 -O2 -I.. concurrency_check.cpp -o concurrency_check
+ * 运行：./concurrency_check（全部通过时退出码为0）
+ */
+
+#include "concurrency_controller.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int g_failures = 0;
+
+static void check(bool ok, const std::string& what) {
+    if (!ok) {
+        g_failures++;
+        std::printf("  FAIL: %s\n", what.c_str());
+    }
+}
+
+/**
+ * 伪造的proc目录，每一步写入一组PSI和平均负载
+ */
+struct FakeProc {
+    std::string root;
+
+    void write(double cpu, double memory, double memory_full, double io, double load1) const {
+        mkdir((root + "/pressure").c_str(), 0755);
+        writePressure("cpu", cpu, -1);
+        writePressure("memory", memory, memory_full);
+        writePressure("io", io, -1);
+        std::ofstream(root + "/loadavg") << load1 << " 0.00 0.00 1/100 1000\n";
+    }
+
+    void writePressure(const char* name, double some, double full) const {
+        std::ofstream file(root + "/pressure/" + name);
+        file << "some avg10=" << some << " avg60=0.00 avg300=0.00 total=0\n";
+        if (full >= 0) {
+            file << "full avg10=" << full << " avg60=0.00 avg300=0.00 total=0\n";
+        }
+    }
+};
+
+/**
+ * 一个样本及其之后期望的并发数
+ */
+struct Step {
+    double cpu;
+    double memory;
+    double memoryFull;
+    double io;
+    double loadPerCpu;
+    size_t expected;
+    const char* what;
+};
+
+static void runSteps(ConcurrencyController& controller, ExecutorPool& pool, const FakeProc& proc,
+                     const std::vector<Step>& steps, size_t cpus) {
+    for (size_t i = 0; i < steps.size(); ++i) {
+        const Step& step = steps[i];
+        proc.write(step.cpu, step.memory, step.memoryFull, step.io, step.loadPerCpu * cpus);
+        size_t limit = controller.update(controller.sample(proc.root));
+        check(limit == step.expected && pool.concurrencyLimit() == step.expected,
+              "第" + std::to_string(i + 1) + "步（" + step.what + "）并发数为 " + std::to_string(limit) +
+                  "，应为 " + std::to_string(step.expected));
+    }
+}
+
+int main() {
+    char root_template[] = "/tmp/concurrency_check_XXXXXX";
+    if (mkdtemp(root_template) == nullptr) {
+        std::perror("mkdtemp");
+        return 2;
+    }
+    FakeProc proc{root_template};
+    size_t cpus = std::max<size_t>(1, CpuTopology::instance().cpuCount());
+    std::vector<std::string> log;
+    auto logger = [&log](const std::string& message) {
+        log.push_back(message);
+        std::printf("  [log] %s\n", message.c_str());
+    };
+
+    // 工作线程数为4；用长时间的sleep占住名额，保证一直有任务排队
+    ExecutorPool pool(4);
+    std::vector<FFmpegExecutor::AsyncHandle> handles;
+    for (int i = 0; i < 8; ++i) {
+        ExecutorPool::Job job;
+        job.argv = {"sleep", "30"};
+        handles.push_back(pool.submit(std::move(job)));
+    }
+
+    std::printf("读不到负载\n");
+    {
+        ConcurrencyController controller(pool);
+        controller.setLogger(logger);
+        controller.start(proc.root);
+        check(pool.concurrencyLimit() == 4, "读不到负载时应保持上限4");
+        check(!log.empty(), "读不到负载时应记录日志");
+    }
+
+    std::printf("合成负载序列\n");
+    ConcurrencyConfig config;
+    config.intervalSeconds = 3600;      // 只由下面手动调用update()
+    config.growAfterSamples = 2;
+    config.cooldownSamples = 1;
+    ConcurrencyController controller(pool, config);
+    controller.setLogger(logger);
+    proc.write(0, 0, 0, 0, 0);
+    log.clear();
+    controller.start(proc.root);
+    check(pool.concurrencyLimit() == 1, "启动后应从下限1开始");
+    std::vector<Step> steps = {
+        {0, 0, 0, 0, 0.1, 1, "低负载第1次"},
+        {0, 0, 0, 0, 0.1, 2, "连续2次低负载，增加"},
+        {0, 0, 0, 0, 0.1, 2, "冷却期内不增加"},
+        {0, 0, 0, 0, 0.1, 3, "连续2次低负载，增加"},
+        {60, 0, 0, 0, 0.5, 2, "增加后CPU压力过高，立即减少"},
+        {60, 0, 0, 0, 0.5, 2, "冷却期内不连续减少"},
+        {20, 0, 0, 0, 1.0, 2, "上下阈值之间，不变"},
+        {0, 0, 0, 0, 0.1, 2, "低负载重新计数"},
+        {0, 0, 0, 0, 0.1, 3, "连续2次低负载，增加"},
+        {0, 0, 0, 0, 0.1, 3, "冷却期内不增加"},
+        {0, 0, 0, 0, 0.1, 4, "增加到上限"},
+        {0, 0, 0, 0, 0.1, 4, "冷却期内不增加"},
+        {0, 0, 0, 0, 0.1, 4, "已到上限"},
+        {0, 0, 0, 70, 0.5, 3, "I/O压力过高，减少"},
+        {0, 0, 5, 0, 0.5, 3, "冷却期内不连续减少"},
+        {0, 0, 5, 0, 0.5, 2, "内存full压力过高，减少"},
+        {0, 0, 0, 0, 2.0, 2, "冷却期内不连续减少"},
+        {0, 0, 0, 0, 2.0, 1, "每CPU负载过高，减少"},
+        {0, 0, 0, 0, 2.0, 1, "已到下限"},
+    };
+    runSteps(controller, pool, proc, steps, cpus);
+    size_t decisions = 0;
+    for (const std::string& message : log) {
+        decisions += message.find(" -> ") != std::string::npos ? 1 : 0;
+    }
+    check(decisions == 8, "应记录8次调整，实际 " + std::to_string(decisions));
+
+    std::printf("没有排队的任务\n");
+    for (auto& handle : handles) {
+        handle.cancel();
+    }
+    for (auto& handle : handles) {
+        handle.get();
+    }
+    runSteps(controller, pool, proc,
+             {{0, 0, 0, 0, 0.1, 1, "低负载第1次"}, {0, 0, 0, 0, 0.1, 1, "没有排队，不增加"}}, cpus);
+    controller.stop();
+
+    std::string cleanup = "rm -rf '" + proc.root + "'";
+    if (std::system(cleanup.c_str()) != 0) {
+        std::printf("未能删除临时目录 %s\n", proc.root.c_str());
+    }
+    std::printf(g_failures == 0 ? "全部通过\n" : "%d项失败\n", g_failures);
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,179 @@
+/**
+ * executor_bench.cpp
+ * 执行器吞吐基准：用 fake_ffmpeg 代替真实FFmpeg，测量
+ *   1. 启动延迟：几乎没有输出的任务从execute()调用到返回的耗时
+ *   2. 解析吞吐：单个任务不限速输出大量日志行和统计行时，执行器每秒处理的行数和每行的父进程CPU时间
+ *   3. 单任务端到端开销：限速任务的execute()耗时减去脚本本身的时长
+ *   4. 1..N个并发任务：任务/秒、行/秒、父进程每任务的CPU时间
+ * 开始前先校验：不带换行的覆盖提示能被自动确认、错误行和退出码被正确报告、-progress 管道可用
+ *
+ * 编译：g++ -std=c++17 -O2 fake_ffmpeg.cpp -o fake_ffmpeg
+ *       g++ -std=c++17 -O2 -I.. executor_bench.cpp -o executor_bench -pthread
+ * 运行：./executor_bench [fake_ffmpeg路径=./fake_ffmpeg] [最大并发数=CPU核数] [每轮任务数=32]
+ */
+
+#include "executor_pool.h"
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+
+using Clock = std::chrono::steady_clock;
+
+static std::string g_fake = "./fake_ffmpeg";
+
+/**
+ * 父进程（所有线程）累计消耗的CPU秒数
+ */
+static double parentCpuSeconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static std::vector<std::string> fakeArgs(std::initializer_list<std::string> options) {
+    std::vector<std::string> args = {g_fake};
+    args.insert(args.end(), options);
+    args.insert(args.end(), {"-i", "in.mp4", "out.mp4"});
+    return args;
+}
+
+static void report(const char* name, std::vector<double>& samples) {
+    std::sort(samples.begin(), samples.end());
+    double mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    printf("%-34s mean %9.1f us   p50 %9.1f us   p99 %9.1f us\n", name, mean,
+           samples[samples.size() / 2], samples[samples.size() * 99 / 100]);
+}
+
+static bool check(bool condition, const char* what) {
+    printf("  %-44s %s\n", what, condition ? "ok" : "FAILED");
+    return condition;
+}
+
+/**
+ * 功能校验：基准的数字只有在这些行为正确时才有意义
+ */
+static bool verify() {
+    printf("verify:\n");
+    bool ok = true;
+    FFmpegExecutor executor;
+
+    auto prompted = executor.execute(fakeArgs({"--prompt", "--records", "5"}));
+    ok &= check(prompted.overwritePrompted && prompted.overwriteConfirmed && prompted.success,
+                "unterminated overwrite prompt answered");
+
+    executor.setAutoOverwrite(false);
+    auto declined = executor.execute(fakeArgs({"--prompt", "--records", "5"}));
+    ok &= check(declined.overwritePrompted && !declined.success && declined.exitCode == 1,
+                "declined prompt exits 1");
+    executor.setAutoOverwrite(true);
+
+    auto failed = executor.execute(fakeArgs({"--error", "Error opening output file out.mp4.", "--exit", "2"}));
+    ok &= check(!failed.success && failed.exitCode == 2 && failed.error == "Error opening output file out.mp4.",
+                "error line and exit code reported");
+    ok &= check(failed.logLevels.error == 1 && failed.logLevels.untagged == 0, "[error] level tag counted");
+
+    executor.setLogLevelTags(false);
+    auto untagged = executor.execute(fakeArgs({"--error", "Error opening output file out.mp4.", "--exit", "2"}));
+    ok &= check(untagged.error.find("Error opening") != std::string::npos && untagged.logLevels.error == 0,
+                "keyword fallback without level tags");
+    executor.setLogLevelTags(true);
+
+    int events = 0;
+    executor.setProgressCallback([&](const FFmpegExecutor::ProgressEvent&) { events++; });
+    executor.execute(fakeArgs({"--records", "50"}));
+    ok &= check(events == 50, "50 \\r stats records -> 50 progress events");
+
+    events = 0;
+    executor.setProgressPipe(true);
+    auto piped = executor.execute(fakeArgs({"--records", "50"}));
+    ok &= check(events == 50 && executor.getProgress().finished && piped.success, "-progress pipe blocks");
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        g_fake = argv[1];
+    }
+    size_t max_jobs = argc > 2 ? static_cast<size_t>(atoi(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
+    int jobs_per_round = argc > 3 ? atoi(argv[3]) : 32;
+
+    if (access(g_fake.c_str(), X_OK) != 0) {
+        fprintf(stderr, "找不到 %s，请先编译 fake_ffmpeg.cpp\n", g_fake.c_str());
+        return 1;
+    }
+    if (!verify()) {
+        return 1;
+    }
+
+    FFmpegExecutor executor;
+
+    // 1. 启动延迟
+    std::vector<double> samples;
+    for (int i = 0; i < 200; ++i) {
+        auto start = Clock::now();
+        executor.execute(fakeArgs({"--log-lines", "0", "--records", "0"}));
+        samples.push_back(secondsSince(start) * 1e6);
+    }
+    printf("\n");
+    report("spawn + reap (no output)", samples);
+
+    // 2. 解析吞吐
+    for (size_t line_size : {80, 400}) {
+        long log_lines = 100000;
+        long records = 200000;
+        double cpu_start = parentCpuSeconds();
+        auto start = Clock::now();
+        auto result = executor.execute(fakeArgs({"--log-lines", std::to_string(log_lines), "--line-size",
+                                                 std::to_string(line_size), "--records", std::to_string(records)}));
+        double wall = secondsSince(start);
+        double cpu = parentCpuSeconds() - cpu_start;
+        long lines = log_lines + records;
+        printf("parse %6ld lines x %3zuB + %ld stats: %8.0f lines/s   parent cpu %.2f us/line   child cpu %.2fs%s\n",
+               log_lines, line_size, records, lines / wall, cpu * 1e6 / lines,
+               result.usage.userCpuSeconds + result.usage.systemCpuSeconds, result.success ? "" : "  (FAILED)");
+    }
+
+    // 3. 单任务端到端开销：脚本本身耗时 records/rate
+    samples.clear();
+    for (int i = 0; i < 20; ++i) {
+        auto start = Clock::now();
+        executor.execute(fakeArgs({"--records", "50", "--rate", "1000"}));
+        samples.push_back((secondsSince(start) - 0.05) * 1e6);
+    }
+    report("end-to-end overhead (50 rec @1k/s)", samples);
+
+    // 4. 并发
+    printf("\n%-6s %10s %12s %16s %14s\n", "jobs", "jobs/s", "lines/s", "parent cpu/job", "p50 job ms");
+    for (size_t jobs = 1; jobs <= max_jobs; jobs = jobs < max_jobs && jobs * 2 > max_jobs ? max_jobs : jobs * 2) {
+        ExecutorPool pool(jobs);
+        std::vector<FFmpegExecutor::AsyncHandle> handles;
+        std::vector<double> job_ms(jobs_per_round);
+        double cpu_start = parentCpuSeconds();
+        auto start = Clock::now();
+        for (int i = 0; i < jobs_per_round; ++i) {
+            ExecutorPool::Job job;
+            job.argv = fakeArgs({"--log-lines", "2000", "--records", "5000"});
+            handles.push_back(pool.submit(std::move(job)));
+        }
+        for (int i = 0; i < jobs_per_round; ++i) {
+            job_ms[i] = handles[i].get().usage.wallSeconds * 1000;
+        }
+        double wall = secondsSince(start);
+        double cpu = parentCpuSeconds() - cpu_start;
+        std::sort(job_ms.begin(), job_ms.end());
+        printf("%-6zu %10.1f %12.0f %13.2f ms %14.2f\n", jobs, jobs_per_round / wall,
+               jobs_per_round * 7000.0 / wall, cpu * 1000 / jobs_per_round, job_ms[job_ms.size() / 2]);
+        if (jobs == max_jobs) {
+            break;
+        }
+    }
+    return 0;
+}
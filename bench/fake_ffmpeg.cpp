@@ -0,0 +1,168 @@
+/**
+ * fake_ffmpeg.cpp
+ * 代替真实FFmpeg的脚本化输出程序，不需要媒体文件即可测量执行器的开销
+ * 按给定的速率和行长输出日志行、以\r结尾的统计行（或 -progress 数据块）、覆盖提示和错误行，
+ * 最后以指定的退出码退出。输出格式与FFmpeg写到stderr的内容一致，每行一次write
+ *
+ * 编译：g++ -std=c++17 -O2 fake_ffmpeg.cpp -o fake_ffmpeg
+ * 运行：./fake_ffmpeg [选项] [FFmpeg参数...]
+ *   --log-lines N    开头输出N行普通日志（默认20）
+ *   --line-size B    每行普通日志的字节数（默认80）
+ *   --records N      输出N条统计记录（默认100）
+ *   --rate R         每秒输出R条统计记录，0表示不限速（默认0）
+ *   --prompt         输出不带换行的覆盖提示并从标准输入读取回答（参数中有 -y 时跳过）
+ *   --error TEXT     结束前输出一行错误信息
+ *   --stall-after K  输出K条统计记录后不再输出并挂起，用于测试停滞检测
+ *   --exit CODE      退出码（默认0；非0时不输出成功汇总行）
+ * 识别的FFmpeg参数：-y、-nostats、-progress pipe:N（向描述符N输出key=value数据块）、
+ *   -loglevel/-v（值中含 +level 时每行带 [info]/[error] 级别标记），其余参数忽略
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * 一次write写出整段内容
+ */
+static void writeAll(int fd, const std::string& text) {
+    size_t written = 0;
+    while (written < text.size()) {
+        ssize_t n = write(fd, text.data() + written, text.size() - written);
+        if (n <= 0) {
+            return;
+        }
+        written += static_cast<size_t>(n);
+    }
+}
+
+int main(int argc, char** argv) {
+    long log_lines = 20;
+    size_t line_size = 80;
+    long records = 100;
+    double rate = 0;
+    bool prompt = false;
+    std::string error;
+    long stall_after = -1;
+    int exit_code = 0;
+    bool overwrite = false;
+    bool stats = true;
+    int progress_fd = -1;
+    bool level_tags = false;
+    std::string output = "out.mp4";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--log-lines" && has_value) {
+            log_lines = atol(argv[++i]);
+        } else if (arg == "--line-size" && has_value) {
+            line_size = static_cast<size_t>(atol(argv[++i]));
+        } else if (arg == "--records" && has_value) {
+            records = atol(argv[++i]);
+        } else if (arg == "--rate" && has_value) {
+            rate = atof(argv[++i]);
+        } else if (arg == "--prompt") {
+            prompt = true;
+        } else if (arg == "--error" && has_value) {
+            error = argv[++i];
+        } else if (arg == "--stall-after" && has_value) {
+            stall_after = atol(argv[++i]);
+        } else if (arg == "--exit" && has_value) {
+            exit_code = atoi(argv[++i]);
+        } else if (arg == "-y") {
+            overwrite = true;
+        } else if (arg == "-nostats") {
+            stats = false;
+        } else if (arg == "-progress" && has_value) {
+            std::string target = argv[++i];
+            if (target.compare(0, 5, "pipe:") == 0) {
+                progress_fd = atoi(target.c_str() + 5);
+            }
+        } else if ((arg == "-loglevel" || arg == "-v") && has_value) {
+            level_tags = std::strstr(argv[++i], "level") != nullptr;
+        } else if (arg == "-threads" && has_value) {
+            ++i;
+        } else if (arg[0] != '-') {
+            output = arg;
+        }
+    }
+
+    // 与FFmpeg一样，级别标记在组件前缀之后；覆盖提示直接写stderr，不带标记
+    std::string info = level_tags ? "[info] " : "";
+    std::string muxer = level_tags ? "[out#0/mp4 @ 0x55d0c0de0000] [info] " : "[out#0/mp4 @ 0x55d0c0de0000] ";
+
+    // 版本信息和输入流信息
+    writeAll(STDERR_FILENO, info + "ffmpeg version 6.1-fake Copyright (c) 2000-2023 the FFmpeg developers\n");
+    for (long i = 0; i < log_lines; ++i) {
+        std::string line = info + "  Stream #0:" + std::to_string(i) + ": Video: h264 (High), yuv420p, 1920x1080, 30 fps ";
+        line.resize(line_size > 0 ? line_size - 1 : 0, '.');
+        line += '\n';
+        writeAll(STDERR_FILENO, line);
+    }
+
+    if (prompt && !overwrite) {
+        writeAll(STDERR_FILENO, "File '" + output + "' already exists. Overwrite? [y/N] ");
+        char answer = 0;
+        if (read(STDIN_FILENO, &answer, 1) != 1 || (answer != 'y' && answer != 'Y')) {
+            writeAll(STDERR_FILENO, (level_tags ? "[fatal] " : "") + std::string("Not overwriting - exiting\n"));
+            return 1;
+        }
+    }
+    writeAll(STDERR_FILENO, info + "Output #0, mp4, to '" + output + "':\n");
+    writeAll(STDERR_FILENO, info + "Press [q] to stop, [?] for help\n");
+
+    Clock::time_point start = Clock::now();
+    char buffer[512];
+    for (long record = 1; record <= records; ++record) {
+        if (rate > 0) {
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(
+                                                      std::chrono::duration<double>(record / rate)));
+        }
+        if (record == stall_after + 1) {
+            // 模拟卡死：不再有任何进展
+            while (true) {
+                pause();
+            }
+        }
+        long long out_time_us = record * 1000000LL / 30;
+        long long size_kb = record * 4;
+        if (stats) {
+            int n = snprintf(buffer, sizeof(buffer),
+                             "%sframe=%5ld fps= 30 q=28.0 size=%8lldkB time=%02lld:%02lld:%02lld.%02lld "
+                             "bitrate=%7.1fkbits/s speed=1.00x    \r",
+                             info.c_str(), record, size_kb, out_time_us / 3600000000LL, out_time_us / 60000000LL % 60,
+                             out_time_us / 1000000LL % 60, out_time_us / 10000LL % 100,
+                             out_time_us > 0 ? size_kb * 8192.0 / out_time_us * 1000 : 0.0);
+            writeAll(STDERR_FILENO, std::string(buffer, static_cast<size_t>(n)));
+        }
+        if (progress_fd != -1) {
+            int n = snprintf(buffer, sizeof(buffer),
+                             "frame=%ld\nfps=30.00\ntotal_size=%lld\nout_time_us=%lld\nout_time_ms=%lld\n"
+                             "bitrate=1000.0kbits/s\nspeed=1.00x\nprogress=%s\n",
+                             record, size_kb * 1024, out_time_us, out_time_us, record == records ? "end" : "continue");
+            writeAll(progress_fd, std::string(buffer, static_cast<size_t>(n)));
+        }
+    }
+    if (stats && records > 0) {
+        writeAll(STDERR_FILENO, "\n");
+    }
+
+    if (!error.empty()) {
+        writeAll(STDERR_FILENO, (level_tags ? "[out#0/mp4 @ 0x55d0c0de0000] [error] " : "[out#0/mp4 @ 0x55d0c0de0000] ") +
+                                    error + "\n");
+    }
+    if (exit_code == 0) {
+        writeAll(STDERR_FILENO, muxer + "video:" + std::to_string(records * 4) +
+                                    "kB audio:0kB subtitle:0kB other streams:0kB global headers:0kB "
+                                    "muxing overhead: 0.051% \n");
+    }
+    return exit_code;
+}
@@ -0,0 +1,116 @@
+/**
+ * line_framer_bench.cpp
+ * 行切分微基准：对比旧的 remaining + output / substr 切分方式与 LineFramer
+ * 通过替换全局operator new统计稳态下每行的内存分配次数
+ *
+ * 编译：g++ -std=c++17 -O2 -I.. line_framer_bench.cpp -o line_framer_bench
+ * 运行：./line_framer_bench [行数=2000000]
+ */
+
+#include "ffmpeg_executor.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+static size_t g_allocations = 0;
+
+void* operator new(size_t size) {
+    g_allocations++;
+    if (void* p = std::malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * 生成类似 -loglevel verbose 的输出
+ */
+static std::string makeVerboseLog(size_t lines) {
+    static const char* samples[] = {
+        "[h264 @ 0x55d0c8a4e2c0] nal_unit_type: 1(Coded slice of a non-IDR picture), nal_ref_idc: 2\n",
+        "[libx264 @ 0x55d0c8a51a40] frame=  812 QP=23.41 NAL=2 Slice:P Poc:104 I:112  P:1302 SKIP:2186 size=9634 bytes\n",
+        "[mp4 @ 0x55d0c8a4f000] Delay between the first packet and last packet in the muxing queue is 10023220 > 10000000: forcing output\n",
+        "    Stream #0:0(und): Video: h264 (High) (avc1 / 0x31637661), yuv420p(progressive), 1920x1080, 8012 kb/s, 29.97 fps\r\n",
+    };
+    std::string log;
+    for (size_t i = 0; i < lines; ++i) {
+        log += samples[i % 4];
+    }
+    return log;
+}
+
+/**
+ * 旧实现：每次读取都拼接 remaining + output，每行 substr 一次
+ */
+static size_t legacySplit(const std::string& log, size_t chunk) {
+    std::string remaining;
+    size_t total = 0;
+    char buffer[4097];
+    for (size_t off = 0; off < log.size(); off += chunk) {
+        size_t n = std::min(chunk, log.size() - off);
+        std::memcpy(buffer, log.data() + off, n);
+        buffer[n] = '\0';
+        std::string full_output = remaining + buffer;
+        std::string line;
+        size_t start_pos = 0;
+        size_t newline_pos;
+        while ((newline_pos = full_output.find('\n', start_pos)) != std::string::npos) {
+            line = full_output.substr(start_pos, newline_pos - start_pos);
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            total += line.size();
+            start_pos = newline_pos + 1;
+        }
+        remaining = full_output.substr(start_pos);
+    }
+    return total;
+}
+
+static size_t framerSplit(LineFramer& framer, const std::string& log, size_t chunk) {
+    size_t total = 0;
+    for (size_t off = 0; off < log.size(); off += chunk) {
+        size_t n = std::min(chunk, log.size() - off);
+        std::memcpy(framer.writePtr(n), log.data() + off, n);
+        framer.commit(n);
+        framer.drain([&](std::string_view line, bool) { total += line.size(); });
+    }
+    framer.finish([&](std::string_view line, bool) { total += line.size(); });
+    return total;
+}
+
+template <typename Fn>
+static void run(const char* name, size_t lines, Fn&& fn) {
+    fn(); // 预热，使缓冲区达到稳态
+    size_t before = g_allocations;
+    auto start = Clock::now();
+    size_t checksum = fn();
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    size_t allocs = g_allocations - before;
+    printf("%-16s %8.2f ns/line   %8.4f allocs/line   (checksum %zu)\n", name, ns / lines,
+           static_cast<double>(allocs) / lines, checksum);
+}
+
+int main(int argc, char** argv) {
+    size_t lines = argc > 1 ? static_cast<size_t>(atol(argv[1])) : 2000000;
+    const size_t chunk = 4096;
+    std::string log = makeVerboseLog(lines);
+    printf("lines=%zu bytes=%zu chunk=%zu\n", lines, log.size(), chunk);
+
+    LineFramer framer;
+    run("legacy substr", lines, [&] { return legacySplit(log, chunk); });
+    run("LineFramer", lines, [&] { return framerSplit(framer, log, chunk); });
+    return 0;
+}
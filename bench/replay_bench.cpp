@@ -0,0 +1,177 @@
+/**
+ * replay_bench.cpp
+ * 录制日志回放基准：把 corpus/ 下的FFmpeg输出样例直接送入执行器的分帧、进度解析和分类流程（不启动进程），
+ * 测量每行耗时和每行内存分配次数，并校验每个样例的成功/错误/覆盖提示判定和各类行数与预期一致
+ * 输出解析的任何优化都以本基准的结果为准：数字变好且校验全部通过才算数
+ *
+ * 样例（按FFmpeg 5.1/6.1的实际输出格式整理）：
+ *   x264_transcode.log         libx264 + aac 转码，统计行以\r结尾，6.1格式的 [out#0/mp4] 汇总行
+ *   x265_transcode.log         libx265 转码，5.1格式的汇总行，x265 [info] 日志
+ *   remux_overwrite.log        -c copy 封装转换，不带换行的覆盖提示，回答不回显，后续输出接在提示之后
+ *   missing_input.log          输入文件不存在
+ *   corrupt_input.log          输入文件损坏（moov atom not found）
+ *   unknown_encoder.log        编码器不存在
+ *   verbose_decode_errors.log  -loglevel verbose 转码，大量详细日志，夹杂解码错误和Non-monotonous DTS警告，最终完成
+ *   missing_input_tagged.log   同 missing_input.log，带 -loglevel +repeat+level 的级别标记
+ *   damaged_ts_tagged.log      带级别标记的受损TS转码：[error] 解码错误、[warning] 警告，元数据里含 Invalid/Unable/Unknown，最终完成
+ *
+ * 编译：g++ -std=c++17 -O2 -I.. replay_bench.cpp -o replay_bench
+ * 运行：./replay_bench [样例目录=corpus] [每个样例回放的总行数=500000]
+ */
+
+#include "ffmpeg_executor.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+
+static size_t g_allocations = 0;
+
+void* operator new(size_t size) {
+    g_allocations++;
+    if (void* p = std::malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * 样例的预期判定
+ */
+struct Expectation {
+    const char* file;
+    int exitCode;               // 录制时进程的退出码
+    bool success;
+    bool overwritePrompted;
+    const char* error;          // ExecuteResult::error应包含的内容，空串表示应没有错误
+    int progressEvents;         // 进度事件数
+    int errorLines;             // 被分类为错误的行数
+    int successLines;           // 被分类为成功完成的行数
+};
+
+static const Expectation kExpectations[] = {
+    {"x264_transcode.log", 0, true, false, "", 26, 0, 1},
+    {"x265_transcode.log", 0, true, false, "", 34, 0, 1},
+    {"remux_overwrite.log", 0, true, true, "", 116, 0, 1},
+    {"missing_input.log", 1, false, false, "Error opening input files: No such file or directory", 0, 3, 0},
+    {"corrupt_input.log", 1, false, false, "Error opening input files: Invalid data found", 0, 4, 0},
+    {"unknown_encoder.log", 8, false, false, "Error opening output files: Encoder not found", 0, 4, 0},
+    // 关键词匹配会把末尾 "1252 frames decoded; 0 decode errors;" 这样的统计行也算作错误，这里记录的是当前行为
+    {"verbose_decode_errors.log", 0, true, false, "0 decode errors", 61, 69, 1},
+    // 带级别标记时只有 [error] 行算作错误，元数据和统计行不再误判
+    {"missing_input_tagged.log", 1, false, false, "Error opening input files: No such file or directory", 0, 3, 0},
+    {"damaged_ts_tagged.log", 0, true, false, "concealing 2201 DC, 2201 AC, 2201 MV errors in P frame", 50, 6, 1},
+};
+
+/**
+ * 一次回放中观察到的分类结果
+ */
+struct Observed {
+    FFmpegExecutor::ExecuteResult result;
+    int progressEvents = 0;
+    int errorLines = 0;
+    int successLines = 0;
+};
+
+static Observed replayChecked(const std::string& log, int exit_code, size_t chunk_size) {
+    Observed observed;
+    FFmpegExecutor executor;
+    executor.setLineCallback([&](std::string_view line) {
+        unsigned line_class = OutputClassifier::instance().classify(line);
+        observed.errorLines += (line_class & OutputClassifier::kError) != 0;
+        observed.successLines += (line_class & OutputClassifier::kSuccess) != 0;
+    });
+    executor.setProgressCallback([&](const FFmpegExecutor::ProgressEvent&) { observed.progressEvents++; });
+    observed.result = executor.replay(log, exit_code, chunk_size);
+    return observed;
+}
+
+/**
+ * 校验一个样例在不同分块大小下的判定都与预期一致
+ */
+static bool verify(const Expectation& expect, const std::string& log) {
+    bool ok = true;
+    for (size_t chunk_size : {size_t(1), size_t(13), size_t(4096), log.size()}) {
+        Observed got = replayChecked(log, expect.exitCode, chunk_size);
+        bool error_ok = expect.error[0] == '\0' ? got.result.error.empty()
+                                                : got.result.error.find(expect.error) != std::string::npos;
+        if (got.result.success != expect.success || got.result.overwritePrompted != expect.overwritePrompted ||
+            !error_ok || got.progressEvents != expect.progressEvents || got.errorLines != expect.errorLines ||
+            got.successLines != expect.successLines) {
+            printf("  %s (chunk %zu): success=%d prompted=%d progress=%d errorLines=%d successLines=%d error=\"%s\"\n",
+                   expect.file, chunk_size, got.result.success, got.result.overwritePrompted, got.progressEvents,
+                   got.errorLines, got.successLines, got.result.error.c_str());
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/**
+ * 统计日志中的记录数（以\n、\r\n或单独的\r结尾）
+ */
+static size_t countRecords(const std::string& log) {
+    LineFramer framer;
+    framer.append(log.data(), log.size());
+    size_t records = 0;
+    auto count = [&](std::string_view, bool) { records++; };
+    framer.drain(count);
+    framer.finish(count);
+    return records;
+}
+
+int main(int argc, char** argv) {
+    std::string corpus = argc > 1 ? argv[1] : "corpus";
+    size_t target_lines = argc > 2 ? static_cast<size_t>(atol(argv[2])) : 500000;
+
+    printf("%-28s %7s %10s %14s %8s\n", "fixture", "lines", "ns/line", "allocs/line", "check");
+    bool all_ok = true;
+    double total_ns = 0;
+    size_t total_lines = 0;
+    for (const auto& expect : kExpectations) {
+        std::ifstream file(corpus + "/" + expect.file, std::ios::binary);
+        if (!file) {
+            fprintf(stderr, "无法打开 %s/%s\n", corpus.c_str(), expect.file);
+            return 1;
+        }
+        std::stringstream content;
+        content << file.rdbuf();
+        std::string log = content.str();
+        size_t records = countRecords(log);
+
+        bool ok = verify(expect, log);
+        all_ok &= ok;
+
+        // 稳态测量：同一执行器反复回放，不设置回调
+        FFmpegExecutor executor;
+        size_t rounds = std::max<size_t>(1, target_lines / std::max<size_t>(records, 1));
+        executor.replay(log, expect.exitCode);
+        size_t allocations_before = g_allocations;
+        auto start = Clock::now();
+        for (size_t i = 0; i < rounds; ++i) {
+            executor.replay(log, expect.exitCode);
+        }
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        size_t allocations = g_allocations - allocations_before;
+
+        printf("%-28s %7zu %10.1f %14.4f %8s\n", expect.file, records, ns / (rounds * records),
+               static_cast<double>(allocations) / (rounds * records), ok ? "ok" : "FAILED");
+        total_ns += ns / rounds;
+        total_lines += records;
+    }
+    printf("%-28s %7zu %10.1f\n", "corpus (one pass)", total_lines, total_ns / total_lines);
+    return all_ok ? 0 : 1;
+}
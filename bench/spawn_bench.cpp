@@ -0,0 +1,68 @@
+/**
+ * spawn_bench.cpp
+ * 进程启动延迟基准：对比 fork()+/bin/sh -c、经shell的posix_spawn 与 直接argv的posix_spawn
+ * 父进程先占用一块内存（默认256MB），以体现fork复制地址空间的开销
+ *
+ * 编译：g++ -std=c++17 -O2 -I.. spawn_bench.cpp -o spawn_bench
+ * 运行：./spawn_bench [次数=200] [占用内存MB=256]
+ */
+
+#include "ffmpeg_executor.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <numeric>
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * 旧实现的启动方式：fork后在子进程中执行 /bin/sh -c
+ */
+static void legacyForkShell(const char* command) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl("/bin/sh", "sh", "-c", command, nullptr);
+        _exit(EXIT_FAILURE);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+}
+
+static void report(const char* name, std::vector<double>& samples) {
+    std::sort(samples.begin(), samples.end());
+    double mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    printf("%-28s mean %9.1f us   p50 %9.1f us   p99 %9.1f us\n", name, mean,
+           samples[samples.size() / 2], samples[samples.size() * 99 / 100]);
+}
+
+static std::vector<double> measure(int runs, const std::function<void()>& fn) {
+    std::vector<double> samples;
+    samples.reserve(runs);
+    for (int i = 0; i < runs; ++i) {
+        auto start = Clock::now();
+        fn();
+        samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+    return samples;
+}
+
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 200;
+    size_t ballast_mb = argc > 2 ? static_cast<size_t>(atoi(argv[2])) : 256;
+
+    // 模拟持有大缓存的父进程
+    std::vector<char> ballast(ballast_mb * 1024 * 1024, 1);
+    printf("runs=%d ballast=%zuMB\n", runs, ballast_mb);
+
+    FFmpegExecutor executor;
+    auto legacy = measure(runs, [] { legacyForkShell("true"); });
+    auto shell = measure(runs, [&] { executor.execute(std::string("true")); });
+    auto direct = measure(runs, [&] { executor.execute(std::vector<std::string>{"true"}); });
+
+    report("fork + sh -c", legacy);
+    report("posix_spawn + sh -c", shell);
+    report("posix_spawn argv", direct);
+    return ballast[0] == 1 ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+/**
+ * topology_check.cpp
+ * CpuTopology::partition 的校验程序：在临时目录中伪造sysfs的CPU拓扑，检查划分结果
+ * 检查项：每个片段不跨NUMA节点/L3域、同一物理核的超线程不被拆到不同片段、所有CPU都分配出去且不重叠
+ *
+ * 编译：g++ -std=c++17 -O2 -I.. topology_check.cpp -o topology_check
+ * 运行：./topology_check（全部通过时退出码为0）
+ */
+
+#include "cpu_topology.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int g_failures = 0;
+
+static void check(bool ok, const std::string& what) {
+    if (!ok) {
+        g_failures++;
+        std::printf("  FAIL: %s\n", what.c_str());
+    }
+}
+
+static void writeFile(const std::string& path, const std::string& text) {
+    for (size_t pos = path.find('/', 1); pos != std::string::npos; pos = path.find('/', pos + 1)) {
+        mkdir(path.substr(0, pos).c_str(), 0755);
+    }
+    std::ofstream(path) << text << "\n";
+}
+
+/**
+ * 伪造的拓扑：nodes个NUMA节点，每个节点一个L3，每个节点cores个物理核，每核threads个超线程
+ * CPU编号与Linux在x86上的习惯一致：先排完所有物理核的第一个线程，再排第二个线程
+ */
+struct FakeLayout {
+    int nodes;
+    int cores;
+    int threads;
+
+    int cpuCount() const {
+        return nodes * cores * threads;
+    }
+
+    int nodeOf(int cpu) const {
+        return (cpu % (nodes * cores)) / cores;
+    }
+
+    int coreOf(int cpu) const {
+        return cpu % (nodes * cores);
+    }
+
+    std::string cpusOfNode(int node) const {
+        std::string list;
+        for (int t = 0; t < threads; ++t) {
+            int first = t * nodes * cores + node * cores;
+            list += (list.empty() ? "" : ",") + std::to_string(first) + "-" + std::to_string(first + cores - 1);
+        }
+        return list;
+    }
+
+    std::string siblingsOf(int cpu) const {
+        std::string list;
+        for (int t = 0; t < threads; ++t) {
+            list += (list.empty() ? "" : ",") + std::to_string(coreOf(cpu) + t * nodes * cores);
+        }
+        return list;
+    }
+
+    void write(const std::string& root) const {
+        for (int node = 0; node < nodes; ++node) {
+            writeFile(root + "/node/node" + std::to_string(node) + "/cpulist", cpusOfNode(node));
+        }
+        for (int cpu = 0; cpu < cpuCount(); ++cpu) {
+            std::string dir = root + "/cpu/cpu" + std::to_string(cpu);
+            writeFile(dir + "/topology/thread_siblings_list", siblingsOf(cpu));
+            writeFile(dir + "/cache/index0/level", "1");
+            writeFile(dir + "/cache/index0/shared_cpu_list", siblingsOf(cpu));
+            writeFile(dir + "/cache/index1/level", "3");
+            writeFile(dir + "/cache/index1/shared_cpu_list", cpusOfNode(nodeOf(cpu)));
+        }
+    }
+};
+
+static void checkLayout(const FakeLayout& layout, const std::string& root) {
+    layout.write(root);
+    std::vector<int> allowed;
+    for (int cpu = 0; cpu < layout.cpuCount(); ++cpu) {
+        allowed.push_back(cpu);
+    }
+    CpuTopology topology(root, allowed);
+    std::printf("%d节点 x %d核 x %d线程：%zu个域\n", layout.nodes, layout.cores, layout.threads,
+                topology.domains().size());
+    check(topology.domains().size() == static_cast<size_t>(layout.nodes), "域数应等于NUMA节点数");
+
+    for (size_t slots = 1; slots <= static_cast<size_t>(layout.cpuCount()) + 3; ++slots) {
+        std::vector<std::vector<int>> parts = topology.partition(slots);
+        std::string label = "slots=" + std::to_string(slots);
+        std::set<int> seen;
+        bool overlap = false;
+        bool split_core = false;
+        bool cross_node = false;
+        std::vector<int> owner(layout.nodes * layout.cores, -1);
+        for (size_t slot = 0; slot < parts.size(); ++slot) {
+            check(!parts[slot].empty(), label + " 片段" + std::to_string(slot) + "为空");
+            for (int cpu : parts[slot]) {
+                overlap |= !seen.insert(cpu).second;
+                cross_node |= layout.nodeOf(cpu) != layout.nodeOf(parts[slot].front());
+                int& core_owner = owner[layout.coreOf(cpu)];
+                split_core |= core_owner != -1 && core_owner != static_cast<int>(slot);
+                core_owner = static_cast<int>(slot);
+            }
+        }
+        size_t total_cores = static_cast<size_t>(layout.nodes * layout.cores);
+        if (slots <= static_cast<size_t>(layout.cpuCount())) {
+            check(!overlap, label + " 片段重叠");
+            check(seen.size() == static_cast<size_t>(layout.cpuCount()), label + " 有CPU未分配");
+        }
+        // 多个节点时，只要任务数不少于节点数，片段就不应跨节点
+        if (slots >= static_cast<size_t>(layout.nodes)) {
+            check(!cross_node, label + " 片段跨NUMA节点");
+        }
+        if (slots <= total_cores) {
+            check(!split_core, label + " 物理核的超线程被拆到不同片段");
+        }
+        if (slots <= 4) {
+            std::printf("  %s:", label.c_str());
+            for (const auto& part : parts) {
+                std::printf(" {%s}", CpuTopology::formatCpuList(part).c_str());
+            }
+            std::printf("\n");
+        }
+    }
+}
+
+int main() {
+    char root_template[] = "/tmp/topology_check_XXXXXX";
+    if (mkdtemp(root_template) == nullptr) {
+        std::perror("mkdtemp");
+        return 2;
+    }
+    std::string root = root_template;
+
+    checkLayout({1, 8, 2}, root + "/a");    // 单路 8核16线程
+    checkLayout({2, 6, 2}, root + "/b");    // 双路 每路6核12线程
+    checkLayout({1, 5, 1}, root + "/c");    // 没有超线程
+    checkLayout({2, 4, 4}, root + "/d");    // 每核4线程
+
+    std::string cleanup = "rm -rf '" + root + "'";
+    if (std::system(cleanup.c_str()) != 0) {
+        std::printf("未能删除临时目录 %s\n", root.c_str());
+    }
+    std::printf(g_failures == 0 ? "全部通过\n" : "%d项失败\n", g_failures);
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,429 @@
+/**
+ * cgroup_envelope.h
+ * 为单个FFmpeg子进程建立cgroup v2子组
+ * 功能：在已委派的父cgroup下创建子组，写入cpu.max、memory.max/memory.high、io.max限制，
+ *       子进程启动后移入该组，结束后读取整组的CPU、内存和I/O用量并删除子组。
+ *       父组的cgroup.subtree_control中没有所需的控制器时先启用它们；父组默认为本进程所在的组，
+ *       cgroup v2不允许仍有进程的组向子组启用控制器，这时需要另外指定没有进程的父组，
+ *       或开启moveSelf把本进程（整个程序，不只是FFmpeg）永久移入其下的叶子组 convenient-cf-self。
+ *       没有cgroup v2、父组未委派或控制器无法启用时不建组，任务照常运行，原因记录在用量的error中
+ */
+
+#ifndef CGROUP_ENVELOPE_H
+#define CGROUP_ENVELOPE_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+/**
+ * cgroup限制，空字符串或小于等于0的数值表示不限制
+ */
+struct CgroupLimits {
+    bool enabled = false;       // 是否为任务建立子组（不设任何限制时只统计用量）
+    std::string parent;         // 已委派的父cgroup目录，空表示当前进程所在的cgroup
+    bool moveSelf = false;      // parent为空且当前cgroup中有进程时，是否把本进程移入其下的叶子组以便启用控制器；
+                                // 本进程从此留在该叶子组中（如离开systemd为它建立的scope）
+    double cpuCores = 0;        // CPU上限（核数），写入cpu.max
+    std::string memoryMax;      // memory.max，如 "2G"
+    std::string memoryHigh;     // memory.high，超过后内核回收内存并限速
+    std::string ioMax;          // io.max，如 "8:0 rbps=104857600 wbps=52428800"，多个设备用';'分隔
+};
+
+/**
+ * 子组在任务结束时的用量，未知的字段为-1
+ */
+struct CgroupUsage {
+    bool applied = false;           // 任务是否运行在子组中
+    std::string error;              // 未能建组的原因
+    long long cpuUsageUsec = -1;    // cpu.stat usage_usec
+    long long cpuUserUsec = -1;     // cpu.stat user_usec
+    long long cpuSystemUsec = -1;   // cpu.stat system_usec
+    long long throttledUsec = -1;   // 因cpu.max被限流的时间
+    long long memoryPeak = -1;      // memory.peak（字节，Linux 5.19+）
+    long long oomKills = -1;        // memory.events oom_kill
+    long long ioReadBytes = -1;     // io.stat 各设备rbytes之和
+    long long ioWriteBytes = -1;    // io.stat 各设备wbytes之和
+};
+
+class CgroupEnvelope {
+public:
+    CgroupEnvelope() = default;
+
+    /**
+     * 析构函数：删除仍存在的子组
+     */
+    ~CgroupEnvelope() {
+        release();
+    }
+
+    CgroupEnvelope(const CgroupEnvelope&) = delete;
+    CgroupEnvelope& operator=(const CgroupEnvelope&) = delete;
+
+    /**
+     * 创建子组并写入限制，任何一项限制写入失败都会删除子组
+     * @param limits 限制
+     * @param usage 失败时写入原因
+     * @return 是否成功
+     */
+    bool create(const CgroupLimits& limits, CgroupUsage& usage) {
+#ifdef __linux__
+        std::string parent = limits.parent.empty() ? currentCgroup() : limits.parent;
+        if (parent.empty()) {
+            usage.error = "未找到cgroup v2挂载点";
+            return false;
+        }
+        // 本进程已被移入叶子组时，默认父组是叶子组的上一级
+        std::string self_suffix = std::string("/") + kSelfLeaf;
+        if (limits.parent.empty() && parent.size() > self_suffix.size() &&
+            parent.compare(parent.size() - self_suffix.size(), self_suffix.size(), self_suffix) == 0) {
+            parent.resize(parent.size() - self_suffix.size());
+        }
+
+        std::vector<std::string> controllers;
+        if (limits.cpuCores > 0) {
+            controllers.push_back("cpu");
+        }
+        if (!limits.memoryMax.empty() || !limits.memoryHigh.empty()) {
+            controllers.push_back("memory");
+        }
+        if (limits.ioMax.find_first_not_of(" ;") != std::string::npos) {
+            controllers.push_back("io");
+        }
+        if (!prepareParent(parent, limits.parent.empty() && limits.moveSelf, controllers, usage.error)) {
+            return false;
+        }
+
+        static std::atomic<unsigned> sequence{0};
+        path_ = parent + "/convenient-cf-" + std::to_string(getpid()) + "-" + std::to_string(sequence++);
+        if (mkdir(path_.c_str(), 0755) != 0) {
+            usage.error = "创建cgroup失败: " + path_ + ": " + strerror(errno);
+            path_.clear();
+            return false;
+        }
+
+        std::vector<std::pair<std::string, std::string>> writes;
+        if (limits.cpuCores > 0) {
+            // 每个100ms周期内允许使用的CPU时间
+            long long quota = static_cast<long long>(limits.cpuCores * kCpuPeriodUsec);
+            writes.emplace_back("cpu.max", std::to_string(quota) + " " + std::to_string(kCpuPeriodUsec));
+        }
+        if (!limits.memoryMax.empty()) {
+            writes.emplace_back("memory.max", limits.memoryMax);
+        }
+        if (!limits.memoryHigh.empty()) {
+            writes.emplace_back("memory.high", limits.memoryHigh);
+        }
+        size_t start = 0;
+        while (start < limits.ioMax.size()) {
+            size_t end = limits.ioMax.find(';', start);
+            if (end == std::string::npos) {
+                end = limits.ioMax.size();
+            }
+            std::string entry = limits.ioMax.substr(start, end - start);
+            if (entry.find_first_not_of(' ') != std::string::npos) {
+                writes.emplace_back("io.max", entry);
+            }
+            start = end + 1;
+        }
+
+        for (const auto& write : writes) {
+            if (!writeFile(path_ + "/" + write.first, write.second)) {
+                // prepareParent()之后仍没有限制文件，说明控制器被其他进程关掉了
+                usage.error = errno == ENOENT ? "cgroup控制器未委派: " + write.first + "不存在"
+                                              : "写入" + write.first + "失败: " + strerror(errno);
+                release();
+                return false;
+            }
+        }
+        return true;
+#else
+        (void)limits;
+        usage.error = "当前平台不支持cgroup";
+        return false;
+#endif
+    }
+
+    /**
+     * 把进程移入子组
+     * 进程由posix_spawn启动后才移入，从exec到写入cgroup.procs之间的短暂时间内不受限制，也不计入子组的用量；
+     * 这期间创建的子进程留在原组中，FFmpeg本身不创建子进程。
+     * （Linux 5.7+的clone3(CLONE_INTO_CGROUP)可以直接在子组中创建进程，但posix_spawn不支持）
+     * @param pid 进程ID
+     * @param usage 成功时标记applied，失败时写入原因
+     * @return 是否成功
+     */
+    bool attach(long pid, CgroupUsage& usage) {
+        if (path_.empty()) {
+            return false;
+        }
+        if (!writeFile(path_ + "/cgroup.procs", std::to_string(pid))) {
+            usage.error = "移入cgroup失败: " + std::string(strerror(errno));
+            release();
+            return false;
+        }
+        usage.applied = true;
+        return true;
+    }
+
+    /**
+     * 读取子组的用量，应在子进程回收之后调用
+     * @param usage 用量
+     */
+    void collect(CgroupUsage& usage) const {
+        if (path_.empty()) {
+            return;
+        }
+        std::string text;
+        if (readFile(path_ + "/cpu.stat", text)) {
+            readKey(text, "usage_usec", usage.cpuUsageUsec);
+            readKey(text, "user_usec", usage.cpuUserUsec);
+            readKey(text, "system_usec", usage.cpuSystemUsec);
+            readKey(text, "throttled_usec", usage.throttledUsec);
+        }
+        if (readFile(path_ + "/memory.peak", text)) {
+            usage.memoryPeak = std::atoll(text.c_str());
+        }
+        if (readFile(path_ + "/memory.events", text)) {
+            readKey(text, "oom_kill", usage.oomKills);
+        }
+        if (readFile(path_ + "/io.stat", text)) {
+            // 每行一个设备："8:0 rbytes=... wbytes=... rios=... wios=..."
+            usage.ioReadBytes = 0;
+            usage.ioWriteBytes = 0;
+            long long value = 0;
+            for (size_t pos = 0; (pos = text.find("bytes=", pos)) != std::string::npos; pos += 6) {
+                value = std::atoll(text.c_str() + pos + 6);
+                if (pos > 0 && text[pos - 1] == 'r') {
+                    usage.ioReadBytes += value;
+                } else if (pos > 0 && text[pos - 1] == 'w') {
+                    usage.ioWriteBytes += value;
+                }
+            }
+        }
+    }
+
+    /**
+     * 删除子组；组内仍有残留进程时先通过cgroup.kill（Linux 5.14+）结束它们
+     */
+    void release() {
+#ifdef __linux__
+        if (path_.empty()) {
+            return;
+        }
+        if (rmdir(path_.c_str()) != 0 && errno == EBUSY) {
+            writeFile(path_ + "/cgroup.kill", "1");
+            for (int attempt = 0; attempt < kRemoveAttempts; ++attempt) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                if (rmdir(path_.c_str()) == 0 || errno != EBUSY) {
+                    break;
+                }
+            }
+        }
+        path_.clear();
+#endif
+    }
+
+    /**
+     * 获取子组目录
+     * @return 目录，未建组时为空
+     */
+    const std::string& path() const {
+        return path_;
+    }
+
+    /**
+     * 查找当前进程所在的cgroup v2目录
+     * @return 目录，没有cgroup v2时返回空
+     */
+    static std::string currentCgroup() {
+#ifdef __linux__
+        // 纯v2系统挂载在/sys/fs/cgroup，混合模式下挂载在/sys/fs/cgroup/unified
+        std::string mount;
+        for (const char* candidate : {"/sys/fs/cgroup", "/sys/fs/cgroup/unified"}) {
+            if (access((std::string(candidate) + "/cgroup.controllers").c_str(), F_OK) == 0) {
+                mount = candidate;
+                break;
+            }
+        }
+        std::string text;
+        if (mount.empty() || !readFile("/proc/self/cgroup", text)) {
+            return std::string();
+        }
+        // v2的条目形如 "0::/user.slice/..."
+        size_t pos = text.compare(0, 3, "0::") == 0 ? 0 : text.find("\n0::");
+        if (pos == std::string::npos) {
+            return std::string();
+        }
+        if (pos != 0) {
+            pos++;
+        }
+        size_t end = text.find('\n', pos);
+        std::string relative = text.substr(pos + 3, end == std::string::npos ? std::string::npos : end - pos - 3);
+        return relative == "/" ? mount : mount + relative;
+#else
+        return std::string();
+#endif
+    }
+
+private:
+    std::string path_;
+
+    // 使用默认父组时本进程移入的叶子组名
+    static constexpr const char* kSelfLeaf = "convenient-cf-self";
+
+    // cpu.max的周期（微秒）
+    static constexpr long long kCpuPeriodUsec = 100000;
+
+    // 删除子组时等待残留进程退出的次数
+    static constexpr int kRemoveAttempts = 50;
+
+    /**
+     * 让父组可以向子组施加限制：必要时把本进程移出父组，再在cgroup.subtree_control中启用控制器
+     * 多个执行器会同时建组，整个过程串行执行；已启用的控制器不重复写入
+     * @param parent 父组目录
+     * @param move_self 父组为本进程所在的组且允许移动本进程时为true，父组中有进程时先把本进程移入叶子组
+     * @param controllers 需要的控制器，如 cpu、memory、io
+     * @param error 失败原因
+     * @return 是否成功
+     */
+    static bool prepareParent(const std::string& parent, bool move_self,
+                              const std::vector<std::string>& controllers, std::string& error) {
+#ifdef __linux__
+        static std::mutex mutex;
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::string text;
+        // 根组没有cgroup.type，也不受“有进程的组不能启用控制器”的限制
+        bool is_root = access((parent + "/cgroup.type").c_str(), F_OK) != 0;
+        if (move_self && !is_root && readFile(parent + "/cgroup.procs", text) && !text.empty()) {
+            std::string leaf = parent + "/" + kSelfLeaf;
+            if (mkdir(leaf.c_str(), 0755) != 0 && errno != EEXIST) {
+                error = "创建cgroup失败: " + leaf + ": " + strerror(errno);
+                return false;
+            }
+            if (!writeFile(leaf + "/cgroup.procs", std::to_string(getpid()))) {
+                error = "无法把本进程移入" + leaf + ": " + strerror(errno);
+                return false;
+            }
+        }
+
+        std::string enabled;
+        std::string available;
+        readFile(parent + "/cgroup.subtree_control", enabled);
+        readFile(parent + "/cgroup.controllers", available);
+        std::string missing;
+        std::string reason;
+        for (const std::string& controller : controllers) {
+            if (hasWord(enabled, controller)) {
+                continue;
+            }
+            if (!hasWord(available, controller)) {
+                reason = "上级没有把它委派给 " + parent;
+            } else if (!writeFile(parent + "/cgroup.subtree_control", "+" + controller)) {
+                // EBUSY：父组中还有其他进程；EACCES/EPERM：没有写subtree_control的权限
+                reason = errno == EBUSY ? parent + " 中还有进程，请在cgroup.parent中指定一个没有进程的已委派目录，"
+                                               "或开启cgroup.move_self把本程序移入其下的叶子组"
+                                        : std::string("启用失败: ") + strerror(errno);
+            } else {
+                continue;
+            }
+            missing += missing.empty() ? controller : " " + controller;
+        }
+        if (!missing.empty()) {
+            error = "cgroup控制器未委派: " + missing + "（" + reason + "）";
+            return false;
+        }
+        return true;
+#else
+        (void)parent;
+        (void)move_self;
+        (void)controllers;
+        error = "当前平台不支持cgroup";
+        return false;
+#endif
+    }
+
+    /**
+     * 空格分隔的列表中是否有某一项，如 "cpu io memory pids" 中的 "io"
+     */
+    static bool hasWord(const std::string& list, const std::string& word) {
+        for (size_t pos = 0; (pos = list.find(word, pos)) != std::string::npos; pos += word.size()) {
+            bool starts = pos == 0 || list[pos - 1] == ' ';
+            size_t end = pos + word.size();
+            if (starts && (end == list.size() || list[end] == ' ' || list[end] == '\n')) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * 写入cgroup接口文件，失败时保留errno
+     */
+    static bool writeFile(const std::string& path, const std::string& value) {
+#ifdef __linux__
+        int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+        if (fd == -1) {
+            return false;
+        }
+        bool ok = write(fd, value.data(), value.size()) == static_cast<ssize_t>(value.size());
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        return ok;
+#else
+        (void)path;
+        (void)value;
+        return false;
+#endif
+    }
+
+    /**
+     * 读取整个cgroup接口文件
+     */
+    static bool readFile(const std::string& path, std::string& text) {
+        text.clear();
+        FILE* file = std::fopen(path.c_str(), "r");
+        if (file == nullptr) {
+            return false;
+        }
+        char buffer[4096];
+        size_t bytes_read;
+        while ((bytes_read = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            text.append(buffer, bytes_read);
+        }
+        std::fclose(file);
+        return true;
+    }
+
+    /**
+     * 从 "key value" 形式的多行文本中读取一个值
+     */
+    static void readKey(const std::string& text, const char* key, long long& value) {
+        size_t key_size = std::strlen(key);
+        for (size_t pos = 0; (pos = text.find(key, pos)) != std::string::npos; pos += key_size) {
+            bool line_start = pos == 0 || text[pos - 1] == '\n';
+            if (line_start && pos + key_size < text.size() && text[pos + key_size] == ' ') {
+                value = std::atoll(text.c_str() + pos + key_size + 1);
+                return;
+            }
+        }
+    }
+};
+
+#endif // CGROUP_ENVELOPE_H
@@ -0,0 +1,307 @@
+/**
+ * concurrency_controller.h
+ * 根据系统负载自动调整执行器池的并发任务数
+ * 功能：定时读取 /proc/pressure/{cpu,memory,io} 和 /proc/loadavg，任一指标超过上阈值时减少一个并发名额，
+ *       全部指标低于下阈值且连续若干次采样、仍有任务排队时增加一个名额；上下阈值之间保持不变（滞回），
+ *       每次调整后冷却若干次采样。每个决定连同触发它的指标写入日志
+ */
+
+#ifndef CONCURRENCY_CONTROLLER_H
+#define CONCURRENCY_CONTROLLER_H
+
+#include "executor_pool.h"
+#include "cpu_topology.h"
+
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <string>
+
+/**
+ * 一次负载采样，未知的字段为-1
+ * PSI的值为最近10秒内有任务因该资源而停顿的时间百分比
+ */
+struct LoadSample {
+    double cpuSome = -1;        // /proc/pressure/cpu some avg10
+    double memorySome = -1;     // /proc/pressure/memory some avg10
+    double memoryFull = -1;     // /proc/pressure/memory full avg10
+    double ioSome = -1;         // /proc/pressure/io some avg10
+    double loadPerCpu = -1;     // 1分钟平均负载除以可用CPU数
+};
+
+/**
+ * 并发控制参数
+ */
+struct ConcurrencyConfig {
+    size_t minJobs = 1;                 // 并发任务数下限
+    size_t maxJobs = 0;                 // 并发任务数上限，0表示池的工作线程数
+    double intervalSeconds = 2;         // 采样间隔
+    int growAfterSamples = 3;           // 连续多少次低负载后才增加
+    int cooldownSamples = 2;            // 每次调整后跳过多少次采样
+    double cpuPressureHigh = 40;        // cpu some 上阈值（%）
+    double cpuPressureLow = 10;         // cpu some 下阈值（%）
+    double memoryPressureHigh = 10;     // memory some 上阈值（%）
+    double memoryPressureLow = 2;       // memory some 下阈值（%）
+    double memoryFullHigh = 2;          // memory full 上阈值（%），所有任务都在等内存
+    double ioPressureHigh = 40;         // io some 上阈值（%）
+    double ioPressureLow = 15;          // io some 下阈值（%）
+    double loadPerCpuHigh = 1.2;        // 每CPU负载上阈值
+    double loadPerCpuLow = 0.8;         // 每CPU负载下阈值
+};
+
+class ConcurrencyController {
+public:
+    // 决策日志回调
+    using LogCallback = std::function<void(const std::string& message)>;
+
+    /**
+     * 构造函数，不会启动采样线程
+     * @param pool 被控制的执行器池，生命周期需长于控制器
+     * @param config 控制参数
+     */
+    explicit ConcurrencyController(ExecutorPool& pool, ConcurrencyConfig config = ConcurrencyConfig())
+        : pool_(pool), config_(config), cpu_count_(std::max<size_t>(1, CpuTopology::instance().cpuCount())) {
+        if (config_.maxJobs == 0 || config_.maxJobs > pool_.workerCount()) {
+            config_.maxJobs = pool_.workerCount();
+        }
+        config_.minJobs = std::min(std::max<size_t>(config_.minJobs, 1), config_.maxJobs);
+        logger_ = [](const std::string& message) {
+            std::clog << "[并发控制] " << message << std::endl;
+        };
+    }
+
+    /**
+     * 析构函数：停止采样线程
+     */
+    ~ConcurrencyController() {
+        stop();
+    }
+
+    ConcurrencyController(const ConcurrencyController&) = delete;
+    ConcurrencyController& operator=(const ConcurrencyController&) = delete;
+
+    /**
+     * 设置决策日志回调，默认写到std::clog，传入空函数关闭日志
+     * @param logger 日志回调（在采样线程中调用）
+     */
+    void setLogger(LogCallback logger) {
+        logger_ = std::move(logger);
+    }
+
+    /**
+     * 启动采样线程，并发数从下限开始逐步增加
+     * 读不到PSI和平均负载时（如Windows）不启动线程，并发数保持上限
+     * @param proc_root proc文件系统的路径
+     */
+    void start(const std::string& proc_root = "/proc") {
+        if (thread_.joinable()) {
+            return;
+        }
+        LoadSample first = sample(proc_root);
+        if (first.cpuSome < 0 && first.loadPerCpu < 0) {
+            pool_.setConcurrencyLimit(config_.maxJobs);
+            log("无法读取PSI和平均负载，不调整，并发数固定为 " + std::to_string(config_.maxJobs));
+            return;
+        }
+        stopping_ = false;
+        pool_.setConcurrencyLimit(config_.minJobs);
+        log("启动: 并发数 " + std::to_string(config_.minJobs) + "，范围 " +
+            std::to_string(config_.minJobs) + "-" + std::to_string(config_.maxJobs));
+        thread_ = std::thread([this, proc_root] {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!wake_.wait_for(lock, std::chrono::duration<double>(config_.intervalSeconds),
+                                   [this] { return stopping_; })) {
+                lock.unlock();
+                update(sample(proc_root));
+                lock.lock();
+            }
+        });
+    }
+
+    /**
+     * 停止采样线程，池保持最后一次设置的并发数
+     */
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    /**
+     * 根据一次采样做出决定并应用到池上，start()启动的线程定时调用，也可手动调用
+     * @param load 负载采样
+     * @return 调整后的并发数
+     */
+    size_t update(const LoadSample& load) {
+        size_t limit = pool_.concurrencyLimit();
+        if (load.cpuSome < 0 && load.loadPerCpu < 0) {
+            if (!warned_unavailable_) {
+                log("无法读取PSI和平均负载，保持并发数 " + std::to_string(limit));
+                warned_unavailable_ = true;
+            }
+            return limit;
+        }
+        // 冷却期内不再增加，也不连续减少（PSI的avg10需要时间反映上一次调整），但增加之后负载过高时立即减少
+        bool cooling = cooldown_ > 0;
+        if (cooling) {
+            cooldown_--;
+        }
+
+        std::string reason;
+        if (above(load, reason)) {
+            low_samples_ = 0;
+            if (limit > config_.minJobs && !(cooling && last_change_ < 0)) {
+                apply(limit - 1, limit, reason);
+                return limit - 1;
+            }
+            return limit;
+        }
+
+        if (!below(load)) {
+            // 处于上下阈值之间，保持不变
+            low_samples_ = 0;
+            return limit;
+        }
+        if (++low_samples_ < config_.growAfterSamples || limit >= config_.maxJobs || cooling) {
+            return limit;
+        }
+        // 没有排队的任务时增加名额没有意义
+        if (pool_.queuedCount() == 0) {
+            return limit;
+        }
+        low_samples_ = 0;
+        apply(limit + 1, limit, "负载较低（" + describe(load) + "）且有任务排队");
+        return limit + 1;
+    }
+
+    /**
+     * 读取当前负载
+     * @param proc_root proc文件系统的路径
+     * @return 负载采样，不支持的指标为-1
+     */
+    LoadSample sample(const std::string& proc_root = "/proc") const {
+        LoadSample load;
+        readPressure(proc_root + "/pressure/cpu", load.cpuSome, nullptr);
+        readPressure(proc_root + "/pressure/memory", load.memorySome, &load.memoryFull);
+        readPressure(proc_root + "/pressure/io", load.ioSome, nullptr);
+        FILE* file = std::fopen((proc_root + "/loadavg").c_str(), "r");
+        if (file != nullptr) {
+            double load1 = 0;
+            if (std::fscanf(file, "%lf", &load1) == 1) {
+                load.loadPerCpu = load1 / cpu_count_;
+            }
+            std::fclose(file);
+        }
+        return load;
+    }
+
+private:
+    ExecutorPool& pool_;
+    ConcurrencyConfig config_;
+    size_t cpu_count_;
+    LogCallback logger_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;             // 受mutex_保护
+    int low_samples_ = 0;               // 连续低负载的采样次数（仅采样线程访问）
+    int cooldown_ = 0;                  // 剩余冷却采样次数（仅采样线程访问）
+    int last_change_ = 0;               // 上一次调整的方向
+    bool warned_unavailable_ = false;
+
+    /**
+     * 是否有指标超过上阈值
+     * @param load 负载采样
+     * @param reason 超过的指标
+     * @return 是否超过
+     */
+    bool above(const LoadSample& load, std::string& reason) const {
+        auto check = [&](double value, double high, const char* name) {
+            if (value >= 0 && value > high && reason.empty()) {
+                reason = std::string(name) + " " + format(value) + " > " + format(high);
+            }
+        };
+        check(load.memoryFull, config_.memoryFullHigh, "内存full压力");
+        check(load.memorySome, config_.memoryPressureHigh, "内存压力");
+        check(load.ioSome, config_.ioPressureHigh, "I/O压力");
+        check(load.cpuSome, config_.cpuPressureHigh, "CPU压力");
+        check(load.loadPerCpu, config_.loadPerCpuHigh, "每CPU负载");
+        return !reason.empty();
+    }
+
+    /**
+     * 是否所有已知指标都低于下阈值
+     * @param load 负载采样
+     * @return 是否都低于
+     */
+    bool below(const LoadSample& load) const {
+        auto low = [](double value, double threshold) {
+            return value < 0 || value < threshold;
+        };
+        return low(load.memorySome, config_.memoryPressureLow) && low(load.ioSome, config_.ioPressureLow) &&
+               low(load.cpuSome, config_.cpuPressureLow) && low(load.loadPerCpu, config_.loadPerCpuLow);
+    }
+
+    /**
+     * 应用新的并发数并记录
+     */
+    void apply(size_t limit, size_t previous, const std::string& reason) {
+        pool_.setConcurrencyLimit(limit);
+        cooldown_ = config_.cooldownSamples;
+        last_change_ = limit > previous ? 1 : -1;
+        log("并发数 " + std::to_string(previous) + " -> " + std::to_string(limit) + ": " + reason);
+    }
+
+    void log(const std::string& message) const {
+        if (logger_) {
+            logger_(message);
+        }
+    }
+
+    /**
+     * 采样的简要描述，用于日志
+     */
+    static std::string describe(const LoadSample& load) {
+        return "cpu " + format(load.cpuSome) + "%, mem " + format(load.memorySome) + "%, io " +
+               format(load.ioSome) + "%, load/cpu " + format(load.loadPerCpu);
+    }
+
+    static std::string format(double value) {
+        if (value < 0) {
+            return "N/A";
+        }
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.2f", value);
+        return text;
+    }
+
+    /**
+     * 读取PSI文件中some和full行的avg10
+     * @param path 文件路径
+     * @param some some行的avg10
+     * @param full full行的avg10，不需要时传nullptr
+     */
+    static void readPressure(const std::string& path, double& some, double* full) {
+        FILE* file = std::fopen(path.c_str(), "r");
+        if (file == nullptr) {
+            return;
+        }
+        char kind[8];
+        double avg10 = 0;
+        while (std::fscanf(file, "%7s avg10=%lf %*[^\n]", kind, &avg10) == 2) {
+            if (std::strcmp(kind, "some") == 0) {
+                some = avg10;
+            } else if (std::strcmp(kind, "full") == 0 && full != nullptr) {
+                *full = avg10;
+            }
+        }
+        std::fclose(file);
+    }
+};
+
+#endif // CONCURRENCY_CONTROLLER_H
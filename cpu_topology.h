@@ -0,0 +1,310 @@
+/**
+ * cpu_topology.h
+ * 从sysfs读取CPU拓扑，为并行任务划分互不重叠的核心集合
+ * 功能：按NUMA节点和共享L3缓存把当前进程可用的CPU分成若干域，同一物理核的超线程相邻排列；
+ *       划分时每个任务尽量落在单个域内，避免跨NUMA节点访问内存和争用其他域的L3
+ */
+
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#include <dirent.h>
+#endif
+
+class CpuTopology {
+public:
+    /**
+     * 一个调度域：同一NUMA节点内共享同一L3缓存的CPU
+     */
+    struct Domain {
+        int node = 0;               // NUMA节点编号
+        std::vector<int> cpus;      // CPU编号，同一物理核的超线程相邻
+        std::vector<size_t> coreStarts; // 每个物理核的第一个CPU在cpus中的下标
+    };
+
+    /**
+     * 获取程序启动后首次使用时探测到的拓扑
+     * @return 拓扑
+     */
+    static const CpuTopology& instance() {
+        static const CpuTopology topology("/sys/devices/system", allowedCpus());
+        return topology;
+    }
+
+    /**
+     * 从指定的sysfs目录读取拓扑
+     * @param sysfs_root sysfs中system目录的路径，通常为 /sys/devices/system
+     * @param allowed 允许使用的CPU，通常为进程当前的亲和性
+     */
+    CpuTopology(const std::string& sysfs_root, const std::vector<int>& allowed) {
+        detect(sysfs_root, allowed);
+    }
+
+    /**
+     * 获取全部调度域，按NUMA节点和CPU编号排序
+     * @return 调度域
+     */
+    const std::vector<Domain>& domains() const {
+        return domains_;
+    }
+
+    /**
+     * 获取可用的CPU总数
+     * @return CPU数
+     */
+    size_t cpuCount() const {
+        size_t count = 0;
+        for (const auto& domain : domains_) {
+            count += domain.cpus.size();
+        }
+        return count;
+    }
+
+    /**
+     * 把可用CPU划分给若干个并行任务
+     * 任务数不多于域数时每个任务分到相邻的若干个完整域；
+     * 任务数多于域数时按CPU数把任务分给各域，域内按物理核切成连续的片段，同一物理核的超线程归同一个任务；
+     * 域内任务数多于物理核数时才按CPU切分
+     * @param slots 任务数
+     * @return 每个任务的CPU集合，拓扑未知时为空集合
+     */
+    std::vector<std::vector<int>> partition(size_t slots) const {
+        std::vector<std::vector<int>> result(slots);
+        if (slots == 0 || domains_.empty()) {
+            return result;
+        }
+
+        if (slots <= domains_.size()) {
+            for (size_t slot = 0; slot < slots; ++slot) {
+                size_t first = slot * domains_.size() / slots;
+                size_t last = (slot + 1) * domains_.size() / slots;
+                for (size_t d = first; d < last; ++d) {
+                    result[slot].insert(result[slot].end(), domains_[d].cpus.begin(), domains_[d].cpus.end());
+                }
+            }
+            return result;
+        }
+
+        // 每个域至少一个任务，其余任务依次分给平均每任务CPU最多的域
+        std::vector<size_t> shares(domains_.size(), 1);
+        for (size_t extra = slots - domains_.size(); extra > 0; --extra) {
+            size_t best = 0;
+            for (size_t d = 1; d < domains_.size(); ++d) {
+                if (domains_[d].cpus.size() * (shares[best] + 1) > domains_[best].cpus.size() * (shares[d] + 1)) {
+                    best = d;
+                }
+            }
+            shares[best]++;
+        }
+
+        size_t slot = 0;
+        for (size_t d = 0; d < domains_.size(); ++d) {
+            const std::vector<int>& cpus = domains_[d].cpus;
+            const std::vector<size_t>& cores = domains_[d].coreStarts;
+            for (size_t part = 0; part < shares[d]; ++part, ++slot) {
+                size_t first = part * cpus.size() / shares[d];
+                size_t last = (part + 1) * cpus.size() / shares[d];
+                if (shares[d] <= cores.size()) {
+                    // 按物理核切分，片段的边界落在核与核之间
+                    size_t first_core = part * cores.size() / shares[d];
+                    size_t last_core = (part + 1) * cores.size() / shares[d];
+                    first = cores[first_core];
+                    last = last_core == cores.size() ? cpus.size() : cores[last_core];
+                }
+                if (first == last) {
+                    // 任务比CPU多，共用一个CPU
+                    result[slot].push_back(cpus[first % cpus.size()]);
+                } else {
+                    result[slot].assign(cpus.begin() + first, cpus.begin() + last);
+                }
+            }
+        }
+        return result;
+    }
+
+    /**
+     * 解析sysfs中的CPU列表，如 "0-3,8-11"
+     * @param text CPU列表
+     * @return CPU编号
+     */
+    static std::vector<int> parseCpuList(std::string_view text) {
+        std::vector<int> cpus;
+        size_t pos = 0;
+        while (pos < text.size()) {
+            size_t end = text.find(',', pos);
+            if (end == std::string_view::npos) {
+                end = text.size();
+            }
+            std::string range(text.substr(pos, end - pos));
+            int first = 0;
+            int last = 0;
+            int fields = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+            if (fields == 1) {
+                last = first;
+            }
+            for (int cpu = first; fields >= 1 && cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+            pos = end + 1;
+        }
+        return cpus;
+    }
+
+    /**
+     * 把CPU编号格式化为列表，如 "0-3,8"
+     * @param cpus CPU编号
+     * @return CPU列表
+     */
+    static std::string formatCpuList(std::vector<int> cpus) {
+        std::sort(cpus.begin(), cpus.end());
+        std::string text;
+        for (size_t i = 0; i < cpus.size();) {
+            size_t j = i;
+            while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+                ++j;
+            }
+            if (!text.empty()) {
+                text += ',';
+            }
+            text += std::to_string(cpus[i]);
+            if (j > i) {
+                text += '-' + std::to_string(cpus[j]);
+            }
+            i = j + 1;
+        }
+        return text;
+    }
+
+    /**
+     * 获取当前进程允许使用的CPU
+     * @return CPU编号
+     */
+    static std::vector<int> allowedCpus() {
+        std::vector<int> cpus;
+#ifdef __linux__
+        cpu_set_t mask;
+        if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &mask)) {
+                    cpus.push_back(cpu);
+                }
+            }
+            return cpus;
+        }
+#endif
+        unsigned count = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned cpu = 0; cpu < count; ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+        return cpus;
+    }
+
+private:
+    std::vector<Domain> domains_;
+
+    /**
+     * 读取sysfs文件的第一行
+     */
+    static bool readLine(const std::string& path, std::string& line) {
+        line.clear();
+        FILE* file = std::fopen(path.c_str(), "r");
+        if (file == nullptr) {
+            return false;
+        }
+        char buffer[1024];
+        if (std::fgets(buffer, sizeof(buffer), file) != nullptr) {
+            line = buffer;
+            while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) {
+                line.pop_back();
+            }
+        }
+        std::fclose(file);
+        return true;
+    }
+
+    /**
+     * 读取NUMA节点和L3缓存，把允许使用的CPU分到各个域；读不到的信息视为单个节点、单个L3
+     */
+    void detect(const std::string& sysfs_root, const std::vector<int>& allowed) {
+        // CPU所属的NUMA节点
+        std::map<int, int> node_of;
+#ifdef __linux__
+        std::string node_dir = sysfs_root + "/node";
+        if (DIR* dir = opendir(node_dir.c_str())) {
+            while (dirent* entry = readdir(dir)) {
+                int node = 0;
+                char tail = 0;
+                if (std::sscanf(entry->d_name, "node%d%c", &node, &tail) != 1) {
+                    continue;
+                }
+                std::string list;
+                if (readLine(node_dir + "/" + entry->d_name + "/cpulist", list)) {
+                    for (int cpu : parseCpuList(list)) {
+                        node_of[cpu] = node;
+                    }
+                }
+            }
+            closedir(dir);
+        }
+#endif
+
+        // 以 (NUMA节点, L3共享组中最小的CPU编号) 区分域，以物理核中最小的CPU编号让超线程相邻
+        std::map<std::pair<int, int>, std::vector<std::pair<int, int>>> groups;
+        for (int cpu : allowed) {
+            std::string cpu_dir = sysfs_root + "/cpu/cpu" + std::to_string(cpu);
+            int l3_key = -1;
+            for (int index = 0;; ++index) {
+                std::string cache_dir = cpu_dir + "/cache/index" + std::to_string(index);
+                std::string level;
+                if (!readLine(cache_dir + "/level", level)) {
+                    break;
+                }
+                std::string shared;
+                if (level == "3" && readLine(cache_dir + "/shared_cpu_list", shared)) {
+                    std::vector<int> sharing = parseCpuList(shared);
+                    if (!sharing.empty()) {
+                        l3_key = *std::min_element(sharing.begin(), sharing.end());
+                    }
+                }
+            }
+            int core_key = cpu;
+            std::string siblings;
+            if (readLine(cpu_dir + "/topology/thread_siblings_list", siblings)) {
+                std::vector<int> sharing = parseCpuList(siblings);
+                if (!sharing.empty()) {
+                    core_key = *std::min_element(sharing.begin(), sharing.end());
+                }
+            }
+            auto node = node_of.find(cpu);
+            int node_id = node == node_of.end() ? 0 : node->second;
+            groups[{node_id, l3_key}].emplace_back(core_key, cpu);
+        }
+
+        for (auto& group : groups) {
+            std::sort(group.second.begin(), group.second.end());
+            Domain domain;
+            domain.node = group.first.first;
+            for (size_t i = 0; i < group.second.size(); ++i) {
+                if (i == 0 || group.second[i].first != group.second[i - 1].first) {
+                    domain.coreStarts.push_back(domain.cpus.size());
+                }
+                domain.cpus.push_back(group.second[i].second);
+            }
+            domains_.push_back(std::move(domain));
+        }
+    }
+};
+
+#endif // CPU_TOPOLOGY_H
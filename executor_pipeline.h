@@ -0,0 +1,209 @@
+/**
+ * executor_pipeline.h
+ * 用管道串联多个进程的执行器流水线
+ * 功能：第k个阶段的标准输出直接接到第k+1个阶段的标准输入（如解码+滤镜的ffmpeg → 编码的ffmpeg，
+ *       或ffmpeg → 外部分析程序），中间数据不落盘，也不经过本进程；每个阶段由各自的FFmpegExecutor
+ *       运行，标准错误分别解析和保留。可整体取消，结果汇总为一个PipelineResult
+ *
+ * 用法：
+ *     ExecutorPipeline pipeline;
+ *     pipeline.addStage({"ffmpeg", "-i", "in.mkv", "-vf", "scale=1280:-2", "-f", "nut", "-"});
+ *     pipeline.addStage({"ffmpeg", "-f", "nut", "-i", "-", "-c:v", "libx264", "-y", "out.mp4"});
+ *     ExecutorPipeline::PipelineResult result = pipeline.run();
+ * 除第一个阶段外，各阶段的标准输入都是上一阶段的数据，无法回答覆盖提示，需要覆盖时请加 -y
+ */
+
+#ifndef EXECUTOR_PIPELINE_H
+#define EXECUTOR_PIPELINE_H
+
+#include "ffmpeg_executor.h"
+
+#include <array>
+
+class ExecutorPipeline {
+public:
+    /**
+     * 流水线的执行结果
+     */
+    struct PipelineResult {
+        bool success = false;                               // 是否所有阶段都成功
+        int failedStage = -1;                               // 最先结束的失败阶段，全部成功时为-1
+        std::string error;                                  // 失败阶段的错误信息
+        std::vector<FFmpegExecutor::ExecuteResult> stages;  // 各阶段的结果，顺序与添加顺序一致
+    };
+
+    /**
+     * 构造函数
+     * @param pipe_bytes 阶段之间管道的容量（仅Linux，超过 /proc/sys/fs/pipe-max-size 时保持系统默认的64KB）
+     */
+    explicit ExecutorPipeline(size_t pipe_bytes = kDefaultPipeBytes) : pipe_bytes_(pipe_bytes) {}
+
+    ExecutorPipeline(const ExecutorPipeline&) = delete;
+    ExecutorPipeline& operator=(const ExecutorPipeline&) = delete;
+
+    /**
+     * 在流水线末尾添加一个阶段
+     * @param argv 程序及其参数，argv[0]为程序名（按PATH查找）
+     * @return 阶段编号
+     */
+    size_t addStage(std::vector<std::string> argv) {
+        stages_.push_back(std::make_unique<Stage>());
+        stages_.back()->argv = std::move(argv);
+        return stages_.size() - 1;
+    }
+
+    /**
+     * 获取某个阶段的执行器，用于在run()之前设置回调、超时、cgroup等
+     * @param index 阶段编号
+     * @return 执行器
+     */
+    FFmpegExecutor& stage(size_t index) {
+        return stages_[index]->executor;
+    }
+
+    /**
+     * 获取阶段数
+     * @return 阶段数
+     */
+    size_t stageCount() const {
+        return stages_.size();
+    }
+
+    /**
+     * 启动所有阶段并等待全部结束
+     * 任一阶段失败时，相邻阶段会读到EOF或在写入时收到EPIPE而随之结束
+     * @return 执行结果
+     */
+    PipelineResult run() {
+        PipelineResult result;
+        if (stages_.empty()) {
+            result.error = "流水线没有任何阶段";
+            return result;
+        }
+#ifdef _WIN32
+        result.error = "当前平台不支持进程流水线";
+        return result;
+#else
+        // 先建好全部管道，任何一个失败都不启动进程
+        std::vector<std::array<int, 2>> pipes(stages_.size() - 1, std::array<int, 2>{-1, -1});
+        for (auto& fds : pipes) {
+            if (!createPipe(fds)) {
+                result.error = "创建阶段间管道失败: " + std::string(strerror(errno));
+                closePipes(pipes);
+                return result;
+            }
+#ifdef F_SETPIPE_SZ
+            fcntl(fds[1], F_SETPIPE_SZ, static_cast<int>(pipe_bytes_));
+#endif
+        }
+
+        // 描述符交给各阶段的执行器，子进程启动后由执行器在本进程中关闭
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            handles_.clear();
+            for (size_t i = 0; i < stages_.size(); ++i) {
+                int stdin_fd = i > 0 ? pipes[i - 1][0] : -1;
+                int stdout_fd = i + 1 < stages_.size() ? pipes[i][1] : -1;
+                stages_[i]->executor.setStdioRedirect(stdin_fd, stdout_fd);
+                handles_.push_back(stages_[i]->executor.executeAsync(stages_[i]->argv));
+                if (cancelled_) {
+                    handles_.back().cancel();
+                }
+            }
+        }
+
+        for (size_t i = 0; i < stages_.size(); ++i) {
+            result.stages.push_back(handles_[i].get());
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            handles_.clear();
+            cancelled_ = false;
+        }
+
+        // 各阶段几乎同时启动，从启动到回收用时最短的失败阶段就是最先出错的，其余多半是被它连带结束的
+        double first_exit = std::numeric_limits<double>::max();
+        for (size_t i = 0; i < result.stages.size(); ++i) {
+            const FFmpegExecutor::ExecuteResult& stage_result = result.stages[i];
+            double exit_time = stage_result.usage.wallSeconds < 0 ? 0 : stage_result.usage.wallSeconds;
+            if (!stage_result.success && exit_time < first_exit) {
+                first_exit = exit_time;
+                result.failedStage = static_cast<int>(i);
+            }
+        }
+        result.success = result.failedStage == -1;
+        if (!result.success) {
+            const FFmpegExecutor::ExecuteResult& failed = result.stages[result.failedStage];
+            result.error = "阶段" + std::to_string(result.failedStage) + "失败: " +
+                           (failed.error.empty() ? "退出码 " + std::to_string(failed.exitCode) : failed.error);
+        }
+        return result;
+#endif
+    }
+
+    /**
+     * 取消整条流水线，可在其他线程调用，立即返回
+     * 各阶段按执行器的stop()逐级终止；在run()启动全部阶段之前调用时，启动后立即取消
+     */
+    void cancel() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancelled_ = true;
+        for (auto& handle : handles_) {
+            handle.cancel();
+        }
+    }
+
+private:
+    /**
+     * 一个阶段：参数和运行它的执行器
+     */
+    struct Stage {
+        std::vector<std::string> argv;
+        FFmpegExecutor executor;
+    };
+
+    // 默认的阶段间管道容量：1MB，即Linux默认的 pipe-max-size
+    static constexpr size_t kDefaultPipeBytes = 1024 * 1024;
+
+    size_t pipe_bytes_;
+    std::vector<std::unique_ptr<Stage>> stages_;
+    std::mutex mutex_;
+    std::vector<FFmpegExecutor::AsyncHandle> handles_;  // 受mutex_保护
+    bool cancelled_ = false;                            // 受mutex_保护
+
+#ifndef _WIN32
+    /**
+     * 创建带close-on-exec标志的管道，避免管道端被其他阶段的子进程继承，否则下游读不到EOF
+     * @param fds 管道描述符
+     * @return 是否成功
+     */
+    static bool createPipe(std::array<int, 2>& fds) {
+#ifdef __linux__
+        return pipe2(fds.data(), O_CLOEXEC) == 0;
+#else
+        if (pipe(fds.data()) == -1) {
+            return false;
+        }
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        return true;
+#endif
+    }
+
+    /**
+     * 关闭尚未交给执行器的管道
+     */
+    static void closePipes(std::vector<std::array<int, 2>>& pipes) {
+        for (auto& fds : pipes) {
+            for (int& fd : fds) {
+                if (fd != -1) {
+                    close(fd);
+                    fd = -1;
+                }
+            }
+        }
+    }
+#endif
+};
+
+#endif // EXECUTOR_PIPELINE_H
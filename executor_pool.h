@@ -0,0 +1,350 @@
+/**
+ * executor_pool.h
+ * 并发执行多个FFmpeg任务的执行器池
+ * 功能：固定数量的工作线程各自持有一个FFmpegExecutor，任务按轮询分配到各线程的队列，
+ *       空闲线程从其他线程的队列尾部窃取任务。取任务和结束任务只锁各线程自己的队列，运行中的任务数
+ *       是原子计数；空闲线程在各自的条件变量上休眠，由提交任务的线程直接唤醒。
+ *       每个任务返回一个可取消、可订阅进度的句柄。
+ *       可选地按CPU拓扑给每个工作线程划分一组核心，其上启动的任务都绑定在这组核心上
+ */
+
+#ifndef EXECUTOR_POOL_H
+#define EXECUTOR_POOL_H
+
+#include "ffmpeg_executor.h"
+#include "cpu_topology.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+
+class ExecutorPool {
+public:
+    /**
+     * 任务描述
+     */
+    struct Job {
+        std::vector<std::string> argv;                  // 程序及参数
+        bool autoOverwrite = true;                      // 是否自动确认覆盖
+        bool captureOutput = false;                     // 是否在结果中保留输出
+        bool progressPipe = false;                      // 是否使用 -progress 独立管道
+        long long expectedDurationUs = -1;              // 输入预期时长（微秒）
+        double timeoutSeconds = 0;                      // 最长运行时间，0表示不限制
+        double stallTimeoutSeconds = 0;                 // 进度停滞超时，0表示不检测
+        CgroupLimits cgroup;                            // cgroup v2限制（仅Linux）
+        FFmpegExecutor::LineCallback onLine;            // 每行输出回调（在工作线程中调用）
+        FFmpegExecutor::ProgressCallback onProgress;    // 进度回调（在工作线程中调用）
+    };
+
+    /**
+     * 构造函数
+     * @param workers 同时运行的任务数上限，0表示使用CPU核数
+     * @param pin_workers 是否按NUMA节点和L3缓存给每个工作线程划分不重叠的核心，
+     *                    任务绑定在所属工作线程的核心上并追加相应的 -threads
+     */
+    explicit ExecutorPool(size_t workers = 0, bool pin_workers = false) {
+        if (workers == 0) {
+            workers = std::max(1u, std::thread::hardware_concurrency());
+        }
+        std::vector<std::vector<int>> slices;
+        if (pin_workers) {
+            slices = CpuTopology::instance().partition(workers);
+        }
+        for (size_t i = 0; i < workers; ++i) {
+            workers_.push_back(std::make_unique<Worker>());
+            if (pin_workers) {
+                workers_[i]->executor.setCpuAffinity(slices[i]);
+            }
+        }
+        limit_.store(workers);
+        for (size_t i = 0; i < workers; ++i) {
+            workers_[i]->thread = std::thread(&ExecutorPool::workerLoop, this, i);
+        }
+    }
+
+    /**
+     * 析构函数：执行完已提交的任务后退出
+     */
+    ~ExecutorPool() {
+        shutdown();
+    }
+
+    ExecutorPool(const ExecutorPool&) = delete;
+    ExecutorPool& operator=(const ExecutorPool&) = delete;
+
+    /**
+     * 提交任务
+     * @param job 任务描述
+     * @return 任务句柄；池已关闭时句柄直接带有错误结果
+     */
+    FFmpegExecutor::AsyncHandle submit(Job job) {
+        auto task = std::make_unique<Task>();
+        task->job = std::move(job);
+        task->state = std::make_shared<FFmpegExecutor::AsyncHandle::State>();
+        FFmpegExecutor::AsyncHandle handle(task->state);
+
+        // 只与shutdown()互斥，保证关闭后不会再有任务进入队列
+        std::lock_guard<std::mutex> submit_lock(submit_mutex_);
+        if (stopping_) {
+            FFmpegExecutor::ExecuteResult result = FFmpegExecutor::makeEmptyResult();
+            result.error = "执行器池已关闭";
+            task->state->promise.set_value(std::move(result));
+            return handle;
+        }
+
+        // 轮询分配到各工作线程的队列，再唤醒一个空闲线程：它会先取自己的队列，没有就窃取
+        size_t target = next_worker_++ % workers_.size();
+        {
+            Worker& worker = *workers_[target];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.queue.push_back(std::move(task));
+        }
+        wakeIdle(target);
+        return handle;
+    }
+
+    /**
+     * 获取工作线程数
+     * @return 工作线程数
+     */
+    size_t workerCount() const {
+        return workers_.size();
+    }
+
+    /**
+     * 设置同时运行的任务数上限，范围为1到工作线程数
+     * 降低上限不会中断正在运行的任务，只是在它们结束前不再启动新任务
+     * @param limit 任务数上限
+     */
+    void setConcurrencyLimit(size_t limit) {
+        limit_.store(std::min(std::max<size_t>(limit, 1), workers_.size()));
+        // 上限提高后，休眠的线程可能有名额了
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            wakeIdle(i);
+        }
+    }
+
+    /**
+     * 获取同时运行的任务数上限
+     * @return 任务数上限
+     */
+    size_t concurrencyLimit() const {
+        return limit_.load();
+    }
+
+    /**
+     * 获取正在运行的任务数
+     * @return 任务数
+     */
+    size_t runningCount() const {
+        return running_.load();
+    }
+
+    /**
+     * 获取等待运行的任务数
+     * @return 任务数
+     */
+    size_t queuedCount() const {
+        size_t queued = 0;
+        for (const auto& worker : workers_) {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            queued += worker->queue.size();
+        }
+        return queued;
+    }
+
+    /**
+     * 停止接受新任务，等待已提交的任务全部完成
+     */
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(submit_mutex_);
+            if (stopping_) {
+                return;
+            }
+            stopping_ = true;
+        }
+        for (auto& worker : workers_) {
+            signal(*worker);
+        }
+        for (auto& worker : workers_) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+    }
+
+private:
+    struct Task {
+        Job job;
+        std::shared_ptr<FFmpegExecutor::AsyncHandle::State> state;
+    };
+
+    struct Worker {
+        mutable std::mutex mutex;
+        std::condition_variable wake;
+        std::deque<std::unique_ptr<Task>> queue;    // 受mutex保护
+        bool signaled = false;                      // 受mutex保护，休眠时由其他线程置位唤醒
+        std::atomic<bool> idle{false};              // 队列都取空、准备休眠或正在休眠
+        FFmpegExecutor executor;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex submit_mutex_;               // 只在submit()和shutdown()之间互斥
+    std::atomic<size_t> running_{0};        // 正在运行的任务数
+    std::atomic<size_t> limit_{0};          // 同时运行的任务数上限
+    std::atomic<size_t> next_worker_{0};
+    std::atomic<bool> stopping_{false};
+
+    /**
+     * 唤醒一个工作线程
+     * @param worker 工作线程
+     */
+    static void signal(Worker& worker) {
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.signaled = true;
+        }
+        worker.wake.notify_one();
+    }
+
+    /**
+     * 从first开始找一个空闲的工作线程并唤醒它；清除空闲标记，同时提交的任务不会都唤醒同一个线程
+     * @param first 优先唤醒的工作线程编号
+     */
+    void wakeIdle(size_t first) {
+        for (size_t offset = 0; offset < workers_.size(); ++offset) {
+            Worker& worker = *workers_[(first + offset) % workers_.size()];
+            if (worker.idle.load() && worker.idle.exchange(false)) {
+                signal(worker);
+                return;
+            }
+        }
+    }
+
+    /**
+     * 取出一个任务：先取自己队列的头部，再从其他队列的尾部窃取
+     * @param self 当前工作线程编号
+     * @return 任务，没有任务时返回空
+     */
+    std::unique_ptr<Task> takeTask(size_t self) {
+        {
+            Worker& own = *workers_[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.queue.empty()) {
+                std::unique_ptr<Task> task = std::move(own.queue.front());
+                own.queue.pop_front();
+                return task;
+            }
+        }
+        for (size_t offset = 1; offset < workers_.size(); ++offset) {
+            Worker& victim = *workers_[(self + offset) % workers_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.queue.empty()) {
+                std::unique_ptr<Task> task = std::move(victim.queue.back());
+                victim.queue.pop_back();
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * 占用一个运行名额
+     * @return 是否占到，已达上限时返回false
+     */
+    bool claimSlot() {
+        size_t running = running_.load();
+        do {
+            if (running >= limit_.load()) {
+                return false;
+            }
+        } while (!running_.compare_exchange_weak(running, running + 1));
+        return true;
+    }
+
+    /**
+     * 取出一个任务并占用运行名额
+     * 名额已满时把任务放回自己队列的头部：占着名额的线程结束任务后一定会重新取任务，会取到它
+     * @param self 当前工作线程编号
+     * @return 任务，没有任务或没有名额时返回空
+     */
+    std::unique_ptr<Task> nextTask(size_t self) {
+        while (true) {
+            std::unique_ptr<Task> task = takeTask(self);
+            if (!task) {
+                return nullptr;
+            }
+            if (claimSlot()) {
+                return task;
+            }
+            {
+                Worker& own = *workers_[self];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                own.queue.push_front(std::move(task));
+            }
+            // 任务拿在手里时名额可能刚好空出，而结束的线程没看到它，放回后再检查一次
+            if (running_.load() >= limit_.load()) {
+                return nullptr;
+            }
+        }
+    }
+
+    /**
+     * 工作线程主循环
+     * @param self 工作线程编号
+     */
+    void workerLoop(size_t self) {
+        Worker& me = *workers_[self];
+        while (true) {
+            std::unique_ptr<Task> task = nextTask(self);
+            if (!task) {
+                // 关闭后取不到任务：要么队列都空了，要么名额已满、由正在运行的线程取走剩下的任务
+                if (stopping_) {
+                    return;
+                }
+                // 先标记空闲再取一次：submit()放入任务后若没看到这个标记，这次一定能取到它
+                me.idle = true;
+                task = nextTask(self);
+                if (task) {
+                    // 标记已被submit()清除，说明它唤醒的是本线程，把唤醒转给其他空闲线程
+                    if (!me.idle.exchange(false)) {
+                        wakeIdle(self + 1);
+                    }
+                } else {
+                    std::unique_lock<std::mutex> lock(me.mutex);
+                    me.wake.wait(lock, [&] { return me.signaled || stopping_; });
+                    me.signaled = false;
+                    lock.unlock();
+                    me.idle = false;
+                    continue;
+                }
+            }
+            runTask(me.executor, *task);
+            // 结束后回到循环开头重新取任务，名额已满时等待的任务由这里接手
+            running_--;
+        }
+    }
+
+    /**
+     * 在工作线程的执行器上运行任务
+     * @param executor 执行器
+     * @param task 任务
+     */
+    static void runTask(FFmpegExecutor& executor, Task& task) {
+        const Job& job = task.job;
+        executor.setAutoOverwrite(job.autoOverwrite);
+        executor.setCaptureOutput(job.captureOutput);
+        executor.setProgressPipe(job.progressPipe);
+        executor.setExpectedDuration(job.expectedDurationUs);
+        executor.setTimeout(job.timeoutSeconds);
+        executor.setStallTimeout(job.stallTimeoutSeconds);
+        executor.setCgroupLimits(job.cgroup);
+        executor.setLineCallback(job.onLine);
+        executor.setProgressCallback(job.onProgress);
+        task.state->run(executor, [&] { return executor.execute(job.argv); });
+    }
+};
+
+#endif // EXECUTOR_POOL_H
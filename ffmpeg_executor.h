@@ -17,12 +17,23 @@
 #include <memory>
 #include <algorithm>
 #include <cctype>
+#include <functional>
+#include <string_view>
+#include <cstring>
+#include <cstdio>
+#include <charconv>
+#include <chrono>
+#include <future>
+#include <cstdint>
+#include <iterator>
+#include <limits>
 
 #ifdef _WIN32
 // 定义这些宏来避免Windows头文件中的一些冲突
 #define NOMINMAX           // 避免min/max宏冲突
 #define WIN32_LEAN_AND_MEAN // 排除不常用的Windows服务
 #include <windows.h>
+#include <psapi.h>
 #undef ERROR               // 避免与日志宏冲突
 #undef IGNORE              // 避免与其他代码冲突
 #undef byte                // 避免byte冲突
@@ -30,66 +41,1086 @@
 #include <unistd.h>
 #include <sys/wait.h>
 #include <sys/types.h>
+#include <sys/resource.h>
 #include <signal.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <cerrno>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <sched.h>
 #endif
 
+extern char** environ;
+#endif
+
+#include "cgroup_envelope.h"
+
+/**
+ * 定长输出日志：保留开头的若干字节和最近的若干字节，中间部分丢弃并计数
+ * 用于限制单个任务保存输出时的内存上限
+ */
+class BoundedLog {
+public:
+    /**
+     * 构造函数
+     * @param head_capacity 保留的开头字节数
+     * @param tail_capacity 保留的末尾字节数（环形缓冲区）
+     */
+    explicit BoundedLog(size_t head_capacity = 64 * 1024, size_t tail_capacity = 256 * 1024)
+        : head_capacity_(head_capacity), tail_capacity_(tail_capacity) {}
+    
+    /**
+     * 修改容量，同时清空已保存的内容
+     * @param head_capacity 保留的开头字节数
+     * @param tail_capacity 保留的末尾字节数
+     */
+    void setCapacity(size_t head_capacity, size_t tail_capacity) {
+        head_capacity_ = head_capacity;
+        tail_capacity_ = tail_capacity;
+        tail_.clear();
+        tail_.shrink_to_fit();
+        clear();
+    }
+    
+    /**
+     * 追加一行（自动补换行符）
+     * @param line 行内容
+     */
+    void append(std::string_view line) {
+        // 整行放得下时写入开头区，否则开头区封闭，之后全部进入末尾区
+        if (!head_full_) {
+            if (head_.size() + line.size() + 1 <= head_capacity_) {
+                head_.append(line.data(), line.size());
+                head_ += '\n';
+                return;
+            }
+            head_full_ = true;
+        }
+        appendTail(line.data(), line.size());
+        appendTail("\n", 1);
+    }
+    
+    /**
+     * 清空内容，保留已分配的缓冲区
+     */
+    void clear() {
+        head_.clear();
+        head_full_ = false;
+        tail_start_ = 0;
+        tail_size_ = 0;
+        dropped_ = 0;
+    }
+    
+    /**
+     * 获取被丢弃的字节数
+     * @return 丢弃字节数
+     */
+    size_t droppedBytes() const {
+        return dropped_;
+    }
+    
+    /**
+     * 拼接保存的内容；发生丢弃时在开头和末尾之间插入省略标记
+     * @return 日志文本
+     */
+    std::string str() const {
+        std::string text;
+        text.reserve(head_.size() + tail_size_ + 64);
+        text += head_;
+        
+        size_t skip = 0;
+        if (dropped_ > 0) {
+            // 跳过末尾区中被截断的半行
+            while (skip < tail_size_ && tailAt(skip) != '\n') {
+                skip++;
+            }
+            if (skip < tail_size_) {
+                skip++;
+            }
+            text += "... [省略 " + std::to_string(dropped_ + skip) + " 字节] ...\n";
+        }
+        for (size_t i = skip; i < tail_size_; ++i) {
+            text += tailAt(i);
+        }
+        return text;
+    }
+    
+private:
+    std::string head_;
+    bool head_full_ = false;
+    size_t head_capacity_;
+    std::vector<char> tail_;
+    size_t tail_capacity_;
+    size_t tail_start_ = 0;
+    size_t tail_size_ = 0;
+    size_t dropped_ = 0;
+    
+    char tailAt(size_t index) const {
+        return tail_[(tail_start_ + index) % tail_capacity_];
+    }
+    
+    /**
+     * 写入环形缓冲区，空间不足时覆盖最旧的数据
+     */
+    void appendTail(const char* data, size_t len) {
+        if (tail_capacity_ == 0) {
+            dropped_ += len;
+            return;
+        }
+        if (tail_.size() != tail_capacity_) {
+            tail_.resize(tail_capacity_);
+        }
+        if (len >= tail_capacity_) {
+            dropped_ += tail_size_ + (len - tail_capacity_);
+            std::copy(data + (len - tail_capacity_), data + len, tail_.begin());
+            tail_start_ = 0;
+            tail_size_ = tail_capacity_;
+            return;
+        }
+        size_t overflow = tail_size_ + len > tail_capacity_ ? tail_size_ + len - tail_capacity_ : 0;
+        dropped_ += overflow;
+        tail_start_ = (tail_start_ + overflow) % tail_capacity_;
+        tail_size_ -= overflow;
+        
+        size_t write_pos = (tail_start_ + tail_size_) % tail_capacity_;
+        size_t first = std::min(len, tail_capacity_ - write_pos);
+        std::copy(data, data + first, tail_.begin() + write_pos);
+        std::copy(data + first, data + len, tail_.begin());
+        tail_size_ += len;
+    }
+};
+
+/**
+ * 行分帧器：在一块可复用的缓冲区上原地切分输出
+ * 读取直接写入缓冲区，行以string_view交出，未完成的半行移动到缓冲区开头
+ * 稳态下（行长不超过缓冲区容量）不产生任何内存分配
+ */
+class LineFramer {
+public:
+    /**
+     * 构造函数
+     * @param capacity 初始缓冲区大小
+     */
+    explicit LineFramer(size_t capacity = 64 * 1024) : buffer_(capacity) {}
+    
+    /**
+     * 获取可写区域起始地址，保证至少有min_space字节可写
+     * @param min_space 最小可写字节数
+     * @return 可写区域起始地址
+     */
+    char* writePtr(size_t min_space = 4096) {
+        if (buffer_.size() - end_ < min_space) {
+            buffer_.resize(std::max(buffer_.size() * 2, end_ + min_space));
+        }
+        return buffer_.data() + end_;
+    }
+    
+    /**
+     * 获取当前可写字节数
+     * @return 可写字节数
+     */
+    size_t writeSpace() const {
+        return buffer_.size() - end_;
+    }
+    
+    /**
+     * 确认已写入可写区域的字节数
+     * @param bytes 写入字节数
+     */
+    void commit(size_t bytes) {
+        end_ += bytes;
+    }
+    
+    /**
+     * 复制一段数据到缓冲区（无法直接读入缓冲区时使用）
+     * @param data 数据
+     * @param len 长度
+     */
+    void append(const char* data, size_t len) {
+        std::memcpy(writePtr(len), data, len);
+        end_ += len;
+    }
+    
+    /**
+     * 交出所有完整的记录，记录以\n、\r\n或单独的\r结尾（ffmpeg的统计行只以\r结尾）
+     * 记录视图只在回调期间有效
+     * @param on_line 记录回调 void(std::string_view line, bool carriage_return)，
+     *                carriage_return表示该记录只以\r结尾
+     */
+    template <typename OnLine>
+    void drain(OnLine&& on_line) {
+        const char* base = buffer_.data();
+        const char* end = base + end_;
+        const char* p = base;
+        
+        // 上一批数据以\r结尾时，紧跟的\n与它组成\r\n
+        if (skip_newline_ && p < end) {
+            if (*p == '\n') {
+                ++p;
+            }
+            skip_newline_ = false;
+        }
+        
+        // 缓存下一个\n的位置，避免每条\r记录都重新扫描到缓冲区末尾
+        const char* newline = nullptr;
+        bool newline_known = false;
+        while (p < end) {
+            if (!newline_known || (newline != nullptr && newline < p)) {
+                newline = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+                newline_known = true;
+            }
+            const char* limit = newline != nullptr ? newline : end;
+            const char* cr = static_cast<const char*>(std::memchr(p, '\r', static_cast<size_t>(limit - p)));
+            if (cr == nullptr) {
+                if (newline == nullptr) {
+                    break;
+                }
+                on_line(std::string_view(p, static_cast<size_t>(newline - p)), false);
+                p = newline + 1;
+            } else if (cr + 1 == newline) {
+                on_line(std::string_view(p, static_cast<size_t>(cr - p)), false);
+                p = newline + 1;
+            } else {
+                on_line(std::string_view(p, static_cast<size_t>(cr - p)), true);
+                p = cr + 1;
+                skip_newline_ = (p == end);
+            }
+        }
+        
+        // 把未完成的半行移动到缓冲区开头
+        size_t consumed = static_cast<size_t>(p - base);
+        if (consumed > 0) {
+            std::memmove(buffer_.data(), p, end_ - consumed);
+            end_ -= consumed;
+        }
+    }
+    
+    /**
+     * 交出末尾没有结束符的剩余内容并清空
+     * @param on_line 记录回调 void(std::string_view line, bool carriage_return)
+     */
+    template <typename OnLine>
+    void finish(OnLine&& on_line) {
+        if (end_ > 0) {
+            on_line(std::string_view(buffer_.data(), end_), false);
+        }
+        end_ = 0;
+        skip_newline_ = false;
+    }
+    
+    /**
+     * 获取尚未遇到结束符的半行
+     * @return 半行内容，下次写入前有效
+     */
+    std::string_view pending() const {
+        return std::string_view(buffer_.data(), end_);
+    }
+    
+    /**
+     * 丢弃缓冲区中的内容
+     */
+    void clear() {
+        end_ = 0;
+        skip_newline_ = false;
+    }
+    
+private:
+    std::vector<char> buffer_;
+    size_t end_ = 0;
+    bool skip_newline_ = false;
+};
+
+/**
+ * 输出行分类器：带 -loglevel +level 级别标记的行按标记分类；没有标记的行
+ * 用一个预编译的Aho-Corasick自动机对整行做一次不区分大小写的扫描，
+ * 同时匹配覆盖提示、错误和成功完成的全部关键词，扫描过程中不分配内存
+ */
+class OutputClassifier {
+public:
+    // 分类结果位
+    enum : unsigned {
+        kOverwritePrompt = 1u << 0,     // 覆盖提示
+        kError = 1u << 1,               // 错误信息
+        kSuccess = 1u << 2              // 成功完成
+    };
+    
+    /**
+     * 获取全局共享的分类器（首次调用时构建，线程安全）
+     * @return 分类器
+     */
+    static const OutputClassifier& instance() {
+        static const OutputClassifier classifier;
+        return classifier;
+    }
+    
+    // 日志级别，与 -loglevel +level 加上的 [level] 标记对应
+    enum LogLevel : int {
+        kLevelNone = -1,                // 没有级别标记
+        kLevelPanic, kLevelFatal, kLevelError, kLevelWarning, kLevelInfo, kLevelVerbose, kLevelDebug, kLevelTrace
+    };
+    
+    /**
+     * 解析 -loglevel +level 加上的级别标记，如 "[in#0 @ 0x55c3e1e8f640] [error] Error opening input"
+     * 标记位于可选的 "[组件 @ 地址] " 前缀之后，只检查行首的几个方括号，耗时与行长无关
+     * @param line 输出行
+     * @param message 输出级别标记之后的消息内容，没有标记时为整行
+     * @return 日志级别，没有标记时为kLevelNone
+     */
+    static int parseLevel(std::string_view line, std::string_view& message) {
+        static constexpr std::string_view kLevelNames[] = {
+            "panic", "fatal", "error", "warning", "info", "verbose", "debug", "trace"
+        };
+        message = line;
+        std::string_view rest = line;
+        for (int group = 0; group < 3 && !rest.empty() && rest.front() == '['; ++group) {
+            size_t close = rest.find(']', 1);
+            if (close == std::string_view::npos || close > kMaxPrefixLength) {
+                break;
+            }
+            std::string_view name = rest.substr(1, close - 1);
+            for (int level = kLevelPanic; level <= kLevelTrace; ++level) {
+                if (name == kLevelNames[level]) {
+                    message = rest.substr(std::min(close + 2, rest.size()));
+                    return level;
+                }
+            }
+            // 只跳过 "[组件 @ 地址]" 形式的前缀，"[y/N]" 之类的内容说明这一行没有级别标记
+            if (name.find(" @ ") == std::string_view::npos) {
+                break;
+            }
+            rest.remove_prefix(std::min(close + 2, rest.size()));
+        }
+        return kLevelNone;
+    }
+    
+    /**
+     * 对一行输出分类
+     * @param line 输出行
+     * @return 分类结果位的组合
+     */
+    unsigned classify(std::string_view line) const {
+        std::string_view message;
+        int level = parseLevel(line, message);
+        return classify(line, level, message);
+    }
+    
+    /**
+     * 对已解析出级别标记的一行输出分类
+     * 带标记的行直接按级别判断错误，只有以 "video:" 开头的info行需要检查是否为成功汇总行；
+     * 没有标记的行（旧版FFmpeg、直接写到stderr的覆盖提示、x265等外部库自己的日志）退回到关键词扫描
+     * @param line 输出行
+     * @param level parseLevel()返回的日志级别
+     * @param message parseLevel()输出的消息内容
+     * @return 分类结果位的组合
+     */
+    unsigned classify(std::string_view line, int level, std::string_view message) const {
+        if (level == kLevelNone) {
+            return classifyKeywords(line);
+        }
+        if (level <= kLevelError) {
+            return kError;
+        }
+        if (level == kLevelInfo && message.compare(0, 6, "video:") == 0) {
+            return classifyKeywords(message) & kSuccess;
+        }
+        return 0;
+    }
+    
+    /**
+     * 按关键词对一行输出分类
+     * @param line 输出行
+     * @return 分类结果位的组合
+     */
+    unsigned classifyKeywords(std::string_view line) const {
+        uint32_t hits = matchPatterns(line);
+        unsigned result = 0;
+        
+        // 覆盖提示：
+        // 模式1: File 'xxx' already exists. Overwrite? [y/N]
+        // 模式2: Overwrite? (y/n)
+        // 模式3: 文件已存在，是否覆盖？(中文提示)
+        if (all(hits, kAlreadyExists, kOverwrite) || has(hits, kOverwriteQuestion) ||
+            has(hits, kOverwriteYesNo) || all(hits, kExistsCn, kOverwriteCn)) {
+            result |= kOverwritePrompt;
+        }
+        
+        // 错误关键词，排除"non-monotonous DTS"警告
+        if ((hits & kErrorKeywordMask) != 0 && !has(hits, kNonMonotonous)) {
+            result |= kError;
+        }
+        
+        // 成功完成：末尾的 video:/audio:/subtitle: 汇总行，或 muxing overhead
+        if ((all(hits, kVideo, kAudio) && has(hits, kSubtitle)) || has(hits, kMuxingOverhead)) {
+            result |= kSuccess;
+        }
+        return result;
+    }
+    
+    /**
+     * 扫描一行，返回命中的关键词集合（每个关键词一位）
+     * @param line 输出行
+     * @return 命中的关键词位
+     */
+    uint32_t matchPatterns(std::string_view line) const {
+        uint32_t hits = 0;
+        uint16_t state = 0;
+        for (unsigned char c : line) {
+            state = transitions_[state * alphabet_size_ + char_class_[c]];
+            hits |= outputs_[state];
+        }
+        return hits;
+    }
+    
+private:
+    // 关键词编号，与kPatterns的顺序一致
+    enum Pattern {
+        kAlreadyExists, kOverwrite, kOverwriteQuestion, kOverwriteYesNo, kExistsCn, kOverwriteCn,
+        kErrorFirst, kErrorLast = kErrorFirst + 8,
+        kNonMonotonous, kVideo, kAudio, kSubtitle, kMuxingOverhead,
+        kPatternCount
+    };
+    
+    // 级别标记之前的组件前缀的最大长度
+    static constexpr size_t kMaxPrefixLength = 128;
+    
+    static constexpr uint32_t kErrorKeywordMask = ((1u << (kErrorLast + 1)) - 1) & ~((1u << kErrorFirst) - 1);
+    
+    uint8_t char_class_[256];
+    size_t alphabet_size_ = 1;
+    std::vector<uint16_t> transitions_;
+    std::vector<uint32_t> outputs_;
+    
+    static bool has(uint32_t hits, Pattern pattern) {
+        return (hits & (1u << pattern)) != 0;
+    }
+    
+    static bool all(uint32_t hits, Pattern a, Pattern b) {
+        return has(hits, a) && has(hits, b);
+    }
+    
+    /**
+     * 构建自动机：字符先压缩为关键词中出现过的字符类（大写折叠为小写，其余归为0类），
+     * 再按BFS补全失败转移，得到一张完整的状态转移表
+     */
+    OutputClassifier() {
+        static constexpr std::string_view kPatterns[kPatternCount] = {
+            "already exists", "overwrite", "overwrite?", "overwrite (y/n)", "已存在", "覆盖",
+            // 常见FFmpeg错误关键词
+            "error", "failed", "invalid", "unable", "cannot",
+            "unknown", "not found", "permission denied", "access denied",
+            "non-monotonous", "video:", "audio:", "subtitle:", "muxing overhead"
+        };
+        
+        std::fill(std::begin(char_class_), std::end(char_class_), 0);
+        for (const auto& pattern : kPatterns) {
+            for (unsigned char c : pattern) {
+                if (char_class_[c] == 0) {
+                    char_class_[c] = static_cast<uint8_t>(alphabet_size_++);
+                }
+            }
+        }
+        for (int c = 'A'; c <= 'Z'; ++c) {
+            char_class_[c] = char_class_[c - 'A' + 'a'];
+        }
+        
+        // 构建字典树，-1表示尚无转移
+        std::vector<int> trie(alphabet_size_, -1);
+        outputs_.assign(1, 0);
+        for (int id = 0; id < kPatternCount; ++id) {
+            size_t state = 0;
+            for (unsigned char c : kPatterns[id]) {
+                int& next = trie[state * alphabet_size_ + char_class_[c]];
+                if (next == -1) {
+                    next = static_cast<int>(outputs_.size());
+                    outputs_.push_back(0);
+                    trie.resize(outputs_.size() * alphabet_size_, -1);
+                }
+                state = static_cast<size_t>(trie[state * alphabet_size_ + char_class_[c]]);
+            }
+            outputs_[state] |= 1u << id;
+        }
+        
+        // BFS计算失败链接，并把缺失的转移补成失败状态的转移
+        std::vector<size_t> fail(outputs_.size(), 0);
+        std::vector<size_t> queue;
+        queue.reserve(outputs_.size());
+        for (size_t c = 0; c < alphabet_size_; ++c) {
+            int& next = trie[c];
+            if (next == -1) {
+                next = 0;
+            } else {
+                queue.push_back(static_cast<size_t>(next));
+            }
+        }
+        for (size_t head = 0; head < queue.size(); ++head) {
+            size_t state = queue[head];
+            for (size_t c = 0; c < alphabet_size_; ++c) {
+                int& next = trie[state * alphabet_size_ + c];
+                int fallback = trie[fail[state] * alphabet_size_ + c];
+                if (next == -1) {
+                    next = fallback;
+                } else {
+                    fail[static_cast<size_t>(next)] = static_cast<size_t>(fallback);
+                    outputs_[static_cast<size_t>(next)] |= outputs_[static_cast<size_t>(fallback)];
+                    queue.push_back(static_cast<size_t>(next));
+                }
+            }
+        }
+        
+        transitions_.assign(trie.begin(), trie.end());
+    }
+};
+
+class ExecutorPool;
+
 class FFmpegExecutor {
 public:
     /**
-     * 执行结果结构体
+     * 单个任务的资源消耗，未能获取的字段为-1
+     */
+    struct ResourceUsage {
+        double wallSeconds = -1;            // 从启动到回收子进程的墙钟时间
+        double firstOutputSeconds = -1;     // 从启动到首次产生输出的时间
+        double userCpuSeconds = -1;         // 用户态CPU时间（含子进程等待过的后代）
+        double systemCpuSeconds = -1;       // 内核态CPU时间
+        long long maxRssKb = -1;            // 峰值常驻内存（KB）
+        long long bytesRead = -1;           // 读取字节数（含管道和页缓存命中）
+        long long bytesWritten = -1;        // 写入字节数
+        long long storageBytesRead = -1;    // 实际从存储设备读取的字节数
+        long long storageBytesWritten = -1; // 实际写入存储设备的字节数
+    };
+    
+    /**
+     * 按日志级别统计的输出行数（不含以\r结尾的统计行），需要FFmpeg输出级别标记
+     */
+    struct LogLevelCounts {
+        long long fatal = 0;        // panic和fatal
+        long long error = 0;
+        long long warning = 0;
+        long long info = 0;
+        long long verbose = 0;      // verbose、debug和trace
+        long long untagged = 0;     // 没有级别标记的行（旧版FFmpeg、覆盖提示、外部库直接写出的日志）
+    };
+    
+    /**
+     * 执行结果结构体
+     */
+    struct ExecuteResult {
+        bool success;               // 命令是否执行成功
+        int exitCode;               // 进程退出码
+        std::string output;         // 输出（超出保留上限时只含开头和末尾）
+        size_t outputDroppedBytes;  // 因超出保留上限而丢弃的输出字节数
+        std::string error;          // 错误信息（如果有）
+        bool overwritePrompted;     // 是否检测到覆盖提示
+        bool overwriteConfirmed;    // 是否自动确认覆盖
+        bool timedOut;              // 是否因超过总时长被终止
+        bool stalled;               // 是否因进度停滞被终止
+        ResourceUsage usage;        // 资源消耗
+        CgroupUsage cgroup;         // cgroup子组的用量（仅启用cgroup时）
+        LogLevelCounts logLevels;   // 各日志级别的行数
+    };
+    
+    /**
+     * 进度快照，未知的字段为-1
+     */
+    struct ProgressEvent {
+        long long frame = -1;       // 已输出帧数
+        double fps = -1;            // 当前编码帧率
+        long long totalSize = -1;   // 已输出字节数
+        long long outTimeUs = -1;   // 已输出的媒体时长（微秒）
+        double bitrateKbps = -1;    // 当前码率（kbit/s）
+        double speed = -1;          // 相对实时的倍速
+        double percent = -1;        // 完成百分比（需设置预期时长）
+        double etaSeconds = -1;     // 预计剩余秒数（需设置预期时长）
+        bool finished = false;      // 是否为最后一次进度（-progress 的 progress=end）
+    };
+    
+    // 每行输出回调（行内容不含换行符，仅在回调期间有效）
+    using LineCallback = std::function<void(std::string_view line)>;
+    // 进度更新回调（每条 frame=/size= ... time= 统计记录触发一次）
+    using ProgressCallback = std::function<void(const ProgressEvent& progress)>;
+    // 进程结束回调
+    using ExitCallback = std::function<void(const ExecuteResult& result)>;
+    
+    /**
+     * 异步任务句柄：等待结果、取消任务、订阅进度
+     * 可复制，所有副本指向同一个任务
+     */
+    class AsyncHandle {
+    public:
+        AsyncHandle() = default;
+        
+        /**
+         * 是否关联了任务
+         * @return 是否有效
+         */
+        bool valid() const {
+            return state_ != nullptr;
+        }
+        
+        /**
+         * 等待任务结束并获取结果
+         * @return 执行结果
+         */
+        ExecuteResult get() const {
+            return state_->future.get();
+        }
+        
+        /**
+         * 等待任务结束
+         */
+        void wait() const {
+            state_->future.wait();
+        }
+        
+        /**
+         * 在限定时间内等待任务结束
+         * @param timeout 最长等待时间
+         * @return 任务是否已结束
+         */
+        bool waitFor(std::chrono::milliseconds timeout) const {
+            return state_->future.wait_for(timeout) == std::future_status::ready;
+        }
+        
+        /**
+         * 获取可共享的future，便于与其他异步代码组合
+         * @return 结果的shared_future
+         */
+        std::shared_future<ExecuteResult> future() const {
+            return state_->future;
+        }
+        
+        /**
+         * 取消任务：尚未开始的任务不再启动，正在运行的任务终止子进程
+         */
+        void cancel() {
+            state_->cancel();
+        }
+        
+        /**
+         * 订阅进度更新，回调在执行线程中调用，回调内不要再订阅
+         * @param callback 进度回调
+         */
+        void subscribeProgress(ProgressCallback callback) {
+            std::lock_guard<std::mutex> lock(state_->progress_mutex);
+            state_->subscribers.push_back(std::move(callback));
+        }
+        
+        /**
+         * 获取最近一次的进度快照
+         * @return 进度快照
+         */
+        ProgressEvent progress() const {
+            std::lock_guard<std::mutex> lock(state_->progress_mutex);
+            return state_->latest;
+        }
+        
+    private:
+        friend class FFmpegExecutor;
+        friend class ExecutorPool;
+        
+        /**
+         * 句柄与执行线程共享的状态
+         */
+        struct State {
+            std::promise<ExecuteResult> promise;
+            std::shared_future<ExecuteResult> future;
+            std::atomic<bool> cancelled{false};
+            std::mutex mutex;                       // 保护executor
+            FFmpegExecutor* executor = nullptr;     // 正在运行该任务的执行器
+            std::mutex progress_mutex;              // 保护subscribers和latest
+            std::vector<ProgressCallback> subscribers;
+            ProgressEvent latest;
+            
+            State() : future(promise.get_future().share()) {}
+            
+            void cancel() {
+                cancelled = true;
+                std::lock_guard<std::mutex> lock(mutex);
+                if (executor != nullptr) {
+                    executor->stop();
+                }
+            }
+            
+            void publish(const ProgressEvent& progress) {
+                std::lock_guard<std::mutex> lock(progress_mutex);
+                latest = progress;
+                for (const auto& callback : subscribers) {
+                    callback(progress);
+                }
+            }
+            
+            /**
+             * 在执行器上运行任务体并兑现promise；已取消的任务直接返回取消结果
+             * @param owner 执行器
+             * @param body 任务体，返回ExecuteResult
+             * @param claim 提交时占用执行器的标记，在兑现promise之前清除，等待结果的一方随即可以提交下一个任务
+             */
+            template <typename Body>
+            void run(FFmpegExecutor& owner, Body&& body, std::atomic<bool>* claim = nullptr) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (cancelled) {
+                        ExecuteResult result = makeEmptyResult();
+                        result.error = "任务已取消";
+                        release(claim);
+                        promise.set_value(std::move(result));
+                        return;
+                    }
+                    executor = &owner;
+                    owner.async_state_ = this;
+                }
+                try {
+                    ExecuteResult result = body();
+                    detach(owner);
+                    release(claim);
+                    promise.set_value(std::move(result));
+                } catch (...) {
+                    detach(owner);
+                    release(claim);
+                    promise.set_exception(std::current_exception());
+                }
+            }
+            
+            static void release(std::atomic<bool>* claim) {
+                if (claim != nullptr) {
+                    *claim = false;
+                }
+            }
+            
+            void detach(FFmpegExecutor& owner) {
+                std::lock_guard<std::mutex> lock(mutex);
+                owner.async_state_ = nullptr;
+                executor = nullptr;
+            }
+        };
+        
+        std::shared_ptr<State> state_;
+        
+        explicit AsyncHandle(std::shared_ptr<State> state) : state_(std::move(state)) {}
+    };
+    
+    /**
+     * 构造函数
+     */
+    FFmpegExecutor() : is_running_(false), auto_overwrite_(true), capture_output_(false),
+                       progress_pipe_enabled_(false), use_progress_fd_(false), expected_duration_us_(-1) {
+#ifndef _WIN32
+        // stop()通过该管道唤醒阻塞在poll上的执行线程
+        if (createPipe(wake_pipe_)) {
+            setNonBlocking(wake_pipe_[0]);
+            setNonBlocking(wake_pipe_[1]);
+        }
+#endif
+    }
+    
+    /**
+     * 析构函数：等待未完成的异步任务结束
+     */
+    ~FFmpegExecutor() {
+        if (async_thread_.joinable()) {
+            async_thread_.join();
+        }
+#ifndef _WIN32
+        for (int fd : wake_pipe_) {
+            if (fd != -1) {
+                close(fd);
+            }
+        }
+        closeStdioRedirect();
+#endif
+    }
+    
+    FFmpegExecutor(const FFmpegExecutor&) = delete;
+    FFmpegExecutor& operator=(const FFmpegExecutor&) = delete;
+    
+    /**
+     * 设置是否自动确认覆盖，不确认时自动回答n，FFmpeg随即退出
+     * @param auto_overwrite 是否自动确认覆盖
+     */
+    void setAutoOverwrite(bool auto_overwrite) {
+        auto_overwrite_ = auto_overwrite;
+    }
+    
+    /**
+     * 设置以参数数组启动FFmpeg时是否加上 -loglevel +repeat+level（默认开启）
+     * 开启后每行输出带有 [error]/[warning]/[info] 等级别标记，错误按标记判断而不是按关键词猜测，
+     * 重复的消息也不再被折叠成 "Last message repeated N times"。需要FFmpeg 3.4及以上版本，
+     * 更旧的版本不认识该参数，请关闭；没有级别标记的输出仍按关键词分类
+     * @param enabled 是否开启
+     */
+    void setLogLevelTags(bool enabled) {
+        log_level_tags_ = enabled;
+    }
+    
+    /**
+     * 设置是否在ExecuteResult::output中保留完整输出
+     * 默认不保留，需要逐行处理输出时请使用回调
+     * @param capture 是否保留完整输出
+     */
+    void setCaptureOutput(bool capture) {
+        capture_output_ = capture;
+    }
+    
+    /**
+     * 设置保留输出的上限：保留开头head_bytes字节和最近tail_bytes字节
+     * @param head_bytes 开头保留字节数（默认64KB）
+     * @param tail_bytes 末尾保留字节数（默认256KB）
+     */
+    void setOutputLimits(size_t head_bytes, size_t tail_bytes) {
+        std::lock_guard<std::mutex> lock(output_mutex_);
+        output_log_.setCapacity(head_bytes, tail_bytes);
+    }
+    
+    /**
+     * 设置每行输出回调，在执行线程中调用
+     * @param callback 回调函数，传入空函数取消
+     */
+    void setLineCallback(LineCallback callback) {
+        line_callback_ = std::move(callback);
+    }
+    
+    /**
+     * 设置进度更新回调，在执行线程中调用
+     * @param callback 回调函数，传入空函数取消
      */
-    struct ExecuteResult {
-        bool success;               // 命令是否执行成功
-        int exitCode;               // 进程退出码
-        std::string output;         // 完整输出
-        std::string error;          // 错误信息（如果有）
-        bool overwritePrompted;     // 是否检测到覆盖提示
-        bool overwriteConfirmed;    // 是否自动确认覆盖
-    };
+    void setProgressCallback(ProgressCallback callback) {
+        progress_callback_ = std::move(callback);
+    }
     
     /**
-     * 构造函数
+     * 设置进程结束回调，在execute返回前调用
+     * @param callback 回调函数，传入空函数取消
      */
-    FFmpegExecutor() : is_running_(false), auto_overwrite_(true) {}
+    void setExitCallback(ExitCallback callback) {
+        exit_callback_ = std::move(callback);
+    }
     
     /**
-     * 设置是否自动确认覆盖
-     * @param auto_overwrite 是否自动确认覆盖
+     * 设置是否通过独立的管道读取机器可读的进度（仅对参数数组形式的execute生效）
+     * 开启后自动追加 "-progress pipe:3 -nostats"，进度不再从日志中解析。
+     * Windows下子进程无法继承编号为3的描述符，此设置被忽略，仍解析统计行
+     * @param enabled 是否开启
      */
-    void setAutoOverwrite(bool auto_overwrite) {
-        auto_overwrite_ = auto_overwrite;
+    void setProgressPipe(bool enabled) {
+        progress_pipe_enabled_ = enabled;
+    }
+    
+    /**
+     * 设置输入的预期时长，用于计算完成百分比和预计剩余时间
+     * @param duration_us 预期时长（微秒），小于等于0表示未知
+     */
+    void setExpectedDuration(long long duration_us) {
+        expected_duration_us_ = duration_us;
+    }
+    
+    /**
+     * 设置单个任务的最长运行时间，超时后按stop()的方式终止
+     * @param seconds 秒数，小于等于0表示不限制
+     */
+    void setTimeout(double seconds) {
+        timeout_seconds_ = seconds;
+    }
+    
+    /**
+     * 设置进度停滞超时：帧数、输出时长和输出大小在这段时间内都没有增长时终止任务
+     * 计时从启动开始，因此只适用于会输出进度的FFmpeg任务
+     * @param seconds 秒数，小于等于0表示不检测
+     */
+    void setStallTimeout(double seconds) {
+        stall_timeout_seconds_ = seconds;
+    }
+    
+    /**
+     * 设置终止时每一级信号的宽限时间
+     * @param seconds 秒数（默认5秒）
+     */
+    void setTerminationGrace(double seconds) {
+        termination_grace_seconds_ = std::max(0.0, seconds);
+    }
+    
+    /**
+     * 设置每个任务的cgroup v2限制（仅Linux），子组建立失败时任务不受限制地运行
+     * @param limits 限制，enabled为false时不建组
+     */
+    void setCgroupLimits(const CgroupLimits& limits) {
+        cgroup_limits_ = limits;
+    }
+    
+    /**
+     * 把之后启动的子进程绑定到一组CPU上
+     * 以参数数组执行FFmpeg时，在每个没有指定 -threads（含 -threads:v 等）的输出文件之前追加 "-threads N"，
+     * N为CPU数，使FFmpeg各路输出的编码线程数与绑定的核数一致
+     * @param cpus CPU编号，空表示不绑定
+     * @param limit_threads 是否追加 -threads
+     */
+    void setCpuAffinity(const std::vector<int>& cpus, bool limit_threads = true) {
+        cpu_affinity_ = cpus;
+        limit_threads_ = limit_threads;
+    }
+    
+#ifndef _WIN32
+    /**
+     * 把下一个任务的标准输入和/或标准输出接到给定的描述符上，用于把多个进程用管道串联起来
+     * 标准输出被重定向时，只有标准错误进入输出解析；标准输入被重定向时无法回答覆盖提示
+     * 描述符的所有权转交给执行器：子进程启动后（或启动失败时）在父进程中关闭，
+     * 这样管道另一端的进程才能在子进程退出时读到EOF或收到EPIPE
+     * @param stdin_fd 子进程的标准输入，-1表示使用执行器自己的输入管道
+     * @param stdout_fd 子进程的标准输出，-1表示与标准错误一起进入输出解析
+     */
+    void setStdioRedirect(int stdin_fd, int stdout_fd) {
+        closeStdioRedirect();
+        stdio_redirect_[0] = stdin_fd;
+        stdio_redirect_[1] = stdout_fd;
+    }
+#endif
+    
+    /**
+     * 获取当前任务最近一次的进度快照，可在其他线程调用
+     * @return 进度快照
+     */
+    ProgressEvent getProgress() const {
+        std::lock_guard<std::mutex> lock(progress_mutex_);
+        return latest_progress_;
+    }
+    
+    /**
+     * 解析一条统计行，如 "frame=  120 fps= 30 q=28.0 size=  1024kB time=00:00:04.00 bitrate=2097.2kbits/s speed=1.2x"
+     * @param line 统计行
+     * @param progress 解析结果，只更新行中出现的字段
+     * @return 是否解析到任何字段
+     */
+    static bool parseProgressLine(std::string_view line, ProgressEvent& progress) {
+        bool parsed = false;
+        size_t pos = 0;
+        size_t equal_pos;
+        while ((equal_pos = line.find('=', pos)) != std::string_view::npos) {
+            size_t key_start = line.find_last_of(' ', equal_pos);
+            key_start = (key_start == std::string_view::npos || key_start < pos) ? pos : key_start + 1;
+            std::string_view key = line.substr(key_start, equal_pos - key_start);
+            
+            // 值和等号之间可能有对齐用的空格
+            size_t value_start = line.find_first_not_of(' ', equal_pos + 1);
+            if (value_start == std::string_view::npos) {
+                break;
+            }
+            size_t value_end = line.find(' ', value_start);
+            if (value_end == std::string_view::npos) {
+                value_end = line.size();
+            }
+            parsed |= applyProgressField(key, line.substr(value_start, value_end - value_start), progress);
+            pos = value_end;
+        }
+        return parsed;
     }
     
     /**
      * 执行FFmpeg命令
-     * @param command FFmpeg命令字符串
+     * @param command FFmpeg命令字符串（Unix下经由/bin/sh解析）
      * @return 执行结果
      */
     ExecuteResult execute(const std::string& command) {
-        ExecuteResult result;
-        result.success = false;
-        result.exitCode = -1;
-        result.overwritePrompted = false;
-        result.overwriteConfirmed = false;
-        
+#ifdef _WIN32
+        return run(command);
+#else
+        return run(LaunchSpec{"/bin/sh", "-c", command});
+#endif
+    }
+    
+    /**
+     * 以参数数组执行程序，不经过shell，路径无需额外加引号
+     * @param argv 程序及其参数，argv[0]为程序名（按PATH查找）
+     * @return 执行结果
+     */
+    ExecuteResult execute(const std::vector<std::string>& argv) {
+        if (argv.empty()) {
+            ExecuteResult result = makeEmptyResult();
+            result.error = "参数列表为空";
+            return result;
+        }
+        std::vector<std::string> args = argv;
+        if (!cpu_affinity_.empty() && limit_threads_ && args.size() > 2 && isFFmpegProgram(args[0])) {
+            addThreadLimit(args, cpu_affinity_.size());
+        }
+        // 让每行带上级别标记，按标记判断错误；调用方自己指定了日志级别时不改动
+        if (log_level_tags_ && isFFmpegProgram(args[0]) &&
+            std::find(args.begin(), args.end(), "-loglevel") == args.end() &&
+            std::find(args.begin(), args.end(), "-v") == args.end()) {
+            args.insert(args.begin() + 1, {"-loglevel", "+repeat+level"});
+        }
+#ifdef _WIN32
+        return run(buildWindowsCommandLine(args));
+#else
+        if (progress_pipe_enabled_) {
+            args.insert(args.begin() + 1, {"-progress", "pipe:" + std::to_string(kProgressFd), "-nostats"});
+            return run(args, true);
+        }
+        return run(args);
+#endif
+    }
+    
+    /**
+     * 在后台线程执行FFmpeg命令，立即返回句柄
+     * 同一执行器同时只能运行一个任务，上一个任务未结束（包括已提交、后台线程尚未开始）时
+     * 返回的句柄直接带有错误结果，不会等待
+     * @param command FFmpeg命令字符串（Unix下经由/bin/sh解析）
+     * @return 异步任务句柄
+     */
+    AsyncHandle executeAsync(const std::string& command) {
+        return launchAsync([this, command] { return execute(command); });
+    }
+    
+    /**
+     * 在后台线程以参数数组执行程序，立即返回句柄
+     * @param argv 程序及其参数
+     * @return 异步任务句柄
+     */
+    AsyncHandle executeAsync(std::vector<std::string> argv) {
+        return launchAsync([this, argv = std::move(argv)] { return execute(argv); });
+    }
+    
+    /**
+     * 回放一段录制下来的FFmpeg输出，不启动进程
+     * 按chunk_size分块送入与真实任务相同的分帧、进度解析和分类流程，回调照常触发，
+     * 检测到覆盖提示时不会真正发送回答。用于基准测试和校验输出解析
+     * @param output 录制的输出（stderr原样内容，含\r和\n）
+     * @param exit_code 视为进程退出码
+     * @param chunk_size 每次送入的字节数，模拟从管道分块读取
+     * @return 执行结果
+     */
+    ExecuteResult replay(std::string_view output, int exit_code = 0, size_t chunk_size = 4096) {
+        ExecuteResult result = makeEmptyResult();
         if (is_running_) {
             result.error = "FFmpeg命令已经在执行中";
             return result;
         }
         
         is_running_ = true;
-        output_buffer_.clear();
-        
-        // 创建线程执行命令
-        std::thread exec_thread(&FFmpegExecutor::executeInternal, this, command, std::ref(result));
-        
-        // 等待线程完成
-        if (exec_thread.joinable()) {
-            exec_thread.join();
+        resetRunState(false);
+        chunk_size = std::max<size_t>(chunk_size, 1);
+        for (size_t pos = 0; pos < output.size(); pos += chunk_size) {
+            output_framer_.append(output.data() + pos, std::min(chunk_size, output.size() - pos));
+            processOutput(result);
         }
+        flushOutput(result);
         
+        result.exitCode = exit_code;
+        if (result.exitCode == 0 && !result.success) {
+            result.success = true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(output_mutex_);
+            result.output = output_log_.str();
+            result.outputDroppedBytes = output_log_.droppedBytes();
+            output_log_.clear();
+        }
         is_running_ = false;
+        
+        if (exit_callback_) {
+            exit_callback_(result);
+        }
         return result;
     }
     
@@ -98,26 +1129,45 @@ public:
      * @return 运行状态
      */
     bool isRunning() const {
-        return is_running_;
+        return is_running_ || async_claimed_;
     }
     
     /**
-     * 停止执行
+     * 停止执行，可在其他线程调用，立即返回
+     * 执行线程先向子进程所在的整个进程组发送SIGINT，让FFmpeg写完文件尾正常退出；
+     * 超过宽限时间仍未退出时依次升级为SIGTERM、SIGKILL。
+     * Windows下依次为CTRL_BREAK事件和结束整个作业对象
      */
     void stop() {
-        is_running_ = false;
-        
-#ifdef _WIN32
-        if (process_info_.hProcess != nullptr) {
-            TerminateProcess(process_info_.hProcess, 0);
-        }
-#else
-        if (child_pid_ > 0) {
-            kill(child_pid_, SIGTERM);
+        stop_requested_ = true;
+#ifndef _WIN32
+        if (wake_pipe_[1] != -1) {
+            char wake = 1;
+            ssize_t written = write(wake_pipe_[1], &wake, 1);
+            (void)written;
         }
 #endif
     }
     
+    /**
+     * 创建初始状态的执行结果
+     * @return 执行结果
+     */
+    static ExecuteResult makeEmptyResult() {
+        ExecuteResult result;
+        result.success = false;
+        result.exitCode = -1;
+        result.overwritePrompted = false;
+        result.overwriteConfirmed = false;
+        result.outputDroppedBytes = 0;
+        result.timedOut = false;
+        result.stalled = false;
+        result.usage = ResourceUsage();
+        result.cgroup = CgroupUsage();
+        result.logLevels = LogLevelCounts();
+        return result;
+    }
+    
     /**
      * 获取最后一条错误信息
      * @return 错误信息
@@ -126,153 +1176,620 @@ public:
         return last_error_;
     }
     
+    /**
+     * 程序名（不含目录）中是否含有ffmpeg，只对FFmpeg追加它专有的参数
+     * @param program argv[0]
+     * @return 是否为FFmpeg
+     */
+    static bool isFFmpegProgram(const std::string& program) {
+        size_t name_start = program.find_last_of("/\\");
+        name_start = name_start == std::string::npos ? 0 : name_start + 1;
+        return program.find("ffmpeg", name_start) != std::string::npos;
+    }
+    
+    /**
+     * 找出FFmpeg参数中的各个输出文件：既不是选项、也不是选项值的参数
+     * 每个输出返回 (它的选项起点, 输出文件下标)，选项起点为上一个输出或上一个 -i 的输入之后
+     * 不认识的无值选项会把紧跟的输出文件当作它的值，这个输出就不会被找出
+     * @param args 参数数组，args[0]为程序名
+     * @return 各个输出
+     */
+    static std::vector<std::pair<size_t, size_t>> outputPositions(const std::vector<std::string>& args) {
+        // 不带值的常用选项，其余以'-'开头的参数都视为带一个值
+        static const std::vector<std::string> kFlags = {
+            "-y", "-n", "-hide_banner", "-nostdin", "-stdin", "-nostats", "-stats", "-vn", "-an", "-sn", "-dn",
+            "-shortest", "-re", "-copyts", "-start_at_zero", "-accurate_seek", "-noaccurate_seek", "-benchmark",
+            "-benchmark_all", "-report", "-debug_ts", "-ignore_unknown", "-copy_unknown", "-xerror", "-dump",
+            "-hex", "-autorotate", "-noautorotate", "-autoscale", "-noautoscale", "-vstats", "-copyinkf"};
+        std::vector<std::pair<size_t, size_t>> outputs;
+        size_t block_start = 1;
+        for (size_t i = 1; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+            if (arg == "-i") {
+                block_start = i + 2;
+                ++i;
+            } else if (arg.size() > 1 && arg[0] == '-') {
+                if (std::find(kFlags.begin(), kFlags.end(), arg) == kFlags.end()) {
+                    ++i;
+                }
+            } else {
+                outputs.emplace_back(block_start, i);
+                block_start = i + 1;
+            }
+        }
+        return outputs;
+    }
+    
 private:
+    // 启动描述：Windows下为完整命令行，Unix下为argv
+#ifdef _WIN32
+    using LaunchSpec = std::string;
+#else
+    using LaunchSpec = std::vector<std::string>;
+#endif
+    
+    using Clock = std::chrono::steady_clock;
+    
     std::atomic<bool> is_running_;
-    std::string output_buffer_;
+    std::thread async_thread_;                  // executeAsync使用的后台线程
+    std::atomic<bool> async_claimed_{false};    // executeAsync在调用线程中占用执行器，任务体结束时清除
+    AsyncHandle::State* async_state_ = nullptr; // 当前任务关联的异步句柄状态（仅执行线程访问）
+    BoundedLog output_log_;
+    LineFramer output_framer_;
     std::mutex output_mutex_;
     std::mutex error_mutex_;
+    mutable std::mutex progress_mutex_;
+    ProgressEvent latest_progress_;
     bool auto_overwrite_;
+    bool capture_output_;
+    bool progress_pipe_enabled_;
+    bool use_progress_fd_;              // 当前任务是否使用独立进度管道
+    bool log_level_tags_ = true;        // 是否让FFmpeg输出级别标记
+    long long expected_duration_us_;
+    ProgressEvent pending_progress_;    // 正在累积的 -progress 数据块
     std::string last_error_;
     
+    // 看门狗
+    std::atomic<bool> stop_requested_{false};
+    double timeout_seconds_ = 0;
+    double stall_timeout_seconds_ = 0;
+    double termination_grace_seconds_ = 5;
+    int termination_stage_ = 0;         // 已发出的终止级别，0表示未在终止
+    Clock::time_point next_escalation_; // 升级到下一级终止的时刻
+    Clock::time_point last_advance_time_;
+    ProgressEvent last_advance_;        // 最近一次有进展时的进度
+    std::string termination_reason_;    // 看门狗终止任务的原因
+    CgroupLimits cgroup_limits_;
+    std::vector<int> cpu_affinity_;
+    bool limit_threads_ = true;
+    LineCallback line_callback_;
+    ProgressCallback progress_callback_;
+    ExitCallback exit_callback_;
+    
 #ifdef _WIN32
     HANDLE stdout_read_handle_ = nullptr;
     HANDLE stdout_write_handle_ = nullptr;
     HANDLE stdin_read_handle_ = nullptr;
     HANDLE stdin_write_handle_ = nullptr;
     PROCESS_INFORMATION process_info_ = {0};
+    HANDLE job_handle_ = nullptr;
+    
+    // CTRL_BREAK事件之后直接结束作业对象
+    static constexpr int kFinalTerminationStage = 2;
 #else
     int stdout_pipe_[2] = {-1, -1};
     int stdin_pipe_[2] = {-1, -1};
-    pid_t child_pid_ = -1;
+    int progress_pipe_[2] = {-1, -1};
+    int wake_pipe_[2] = {-1, -1};
+    int stdio_redirect_[2] = {-1, -1};  // 下一个任务的标准输入、标准输出重定向
+    std::atomic<pid_t> child_pid_{-1};
+    LineFramer progress_framer_{4096};
+    
+    // 子进程中 -progress 输出使用的描述符编号
+    static constexpr int kProgressFd = 3;
+    
+    // 没有pidfd时检查子进程退出的间隔（毫秒）
+    static constexpr int kExitCheckIntervalMs = 100;
+    
+    // SIGINT、SIGTERM、SIGKILL
+    static constexpr int kFinalTerminationStage = 3;
+#endif
+    
+    /**
+     * 执行一次启动描述
+     * @param spec 启动描述
+     * @param progress_fd 是否为子进程准备独立的进度管道
+     * @return 执行结果
+     */
+    ExecuteResult run(const LaunchSpec& spec, bool progress_fd = false) {
+        ExecuteResult result = makeEmptyResult();
+        
+        if (is_running_) {
+            result.error = "FFmpeg命令已经在执行中";
+            return result;
+        }
+        
+        is_running_ = true;
+        resetRunState(progress_fd);
+        
+        // 在调用线程中直接执行，需要异步时使用executeAsync
+        executeInternal(spec, result);
+        
+        // 被终止的任务即使输出了完成信息也不算成功
+        if (!termination_reason_.empty()) {
+            result.success = false;
+            result.error = termination_reason_;
+        }
+        
+        is_running_ = false;
+        
+        if (exit_callback_) {
+            exit_callback_(result);
+        }
+        return result;
+    }
+    
+    /**
+     * 清空上一个任务留下的输出、进度和终止状态
+     * @param progress_fd 本次任务是否使用独立进度管道
+     */
+    void resetRunState(bool progress_fd) {
+        output_log_.clear();
+        output_framer_.clear();
+        {
+            std::lock_guard<std::mutex> lock(progress_mutex_);
+            latest_progress_ = ProgressEvent();
+        }
+        pending_progress_ = ProgressEvent();
+        use_progress_fd_ = progress_fd;
+        stop_requested_ = false;
+        termination_stage_ = 0;
+        termination_reason_.clear();
+    }
+    
+    /**
+     * 启动后台线程运行任务体
+     * @param body 任务体，返回ExecuteResult
+     * @return 异步任务句柄
+     */
+    template <typename Body>
+    AsyncHandle launchAsync(Body body) {
+        auto state = std::make_shared<AsyncHandle::State>();
+        // 在调用线程中占用执行器：后台线程还没开始时再次提交也会立即失败，而不是阻塞在join上
+        if (is_running_ || async_claimed_.exchange(true)) {
+            ExecuteResult result = makeEmptyResult();
+            result.error = "FFmpeg命令已经在执行中";
+            state->promise.set_value(std::move(result));
+            return AsyncHandle(state);
+        }
+        
+        // 回收上一个任务的线程，占用标记在它的任务体结束时才清除，此时只剩线程退出
+        if (async_thread_.joinable()) {
+            async_thread_.join();
+        }
+        async_thread_ = std::thread([this, state, body = std::move(body)]() mutable {
+            state->run(*this, body, &async_claimed_);
+        });
+        return AsyncHandle(state);
+    }
+    
+    /**
+     * 在每个没有指定线程数的输出文件之前插入 "-threads N"
+     * -threads 是输出选项，只作用于紧随其后的那个输出，多路输出时要逐个加上
+     * @param args FFmpeg参数数组
+     * @param threads 线程数
+     */
+    static void addThreadLimit(std::vector<std::string>& args, size_t threads) {
+        std::vector<std::pair<size_t, size_t>> outputs = outputPositions(args);
+        // 从后往前插入，前面的下标不受影响
+        for (auto output = outputs.rbegin(); output != outputs.rend(); ++output) {
+            bool specified = std::any_of(args.begin() + output->first, args.begin() + output->second,
+                                         [](const std::string& arg) {
+                return arg == "-threads" || arg.compare(0, 9, "-threads:") == 0;
+            });
+            if (!specified) {
+                args.insert(args.begin() + output->second, {"-threads", std::to_string(threads)});
+            }
+        }
+    }
+    
+    /**
+     * 计算从某时刻到现在经过的秒数
+     * @param start 起始时刻
+     * @return 秒数
+     */
+    static double secondsSince(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    
+    /**
+     * 当前任务是否已被要求停止（stop()或异步句柄取消）
+     * @return 是否要求停止
+     */
+    bool cancelRequested() const {
+        return stop_requested_ || (async_state_ != nullptr && async_state_->cancelled);
+    }
+    
+    /**
+     * 把秒数转换为时钟间隔
+     */
+    static Clock::duration toDuration(double seconds) {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    }
+    
+    /**
+     * 开始为新启动的子进程计时
+     * @param spawn_time 子进程启动时刻
+     */
+    void startWatchdog(Clock::time_point spawn_time) {
+        last_advance_time_ = spawn_time;
+        last_advance_ = ProgressEvent();
+    }
+    
+    /**
+     * 看门狗检查：收到停止请求、超过总时长或进度停滞时开始终止子进程，之后每过宽限时间升级一级
+     * @param spawn_time 子进程启动时刻
+     * @param result 执行结果引用，记录终止原因
+     */
+    void checkWatchdog(Clock::time_point spawn_time, ExecuteResult& result) {
+        Clock::time_point now = Clock::now();
+        if (termination_stage_ == 0) {
+            char seconds[32];
+            if (cancelRequested()) {
+                termination_reason_ = "任务已取消";
+            } else if (timeout_seconds_ > 0 && now >= spawn_time + toDuration(timeout_seconds_)) {
+                std::snprintf(seconds, sizeof(seconds), "%g", timeout_seconds_);
+                termination_reason_ = "执行超时: 超过 " + std::string(seconds) + " 秒";
+                result.timedOut = true;
+            } else if (stall_timeout_seconds_ > 0 && now >= last_advance_time_ + toDuration(stall_timeout_seconds_)) {
+                std::snprintf(seconds, sizeof(seconds), "%g", stall_timeout_seconds_);
+                termination_reason_ = "进度停滞: " + std::string(seconds) + " 秒内没有进展";
+                result.stalled = true;
+            } else {
+                return;
+            }
+        } else if (termination_stage_ >= kFinalTerminationStage || now < next_escalation_) {
+            return;
+        }
+        escalateTermination();
+    }
+    
+    /**
+     * 计算距离下一次需要看门狗检查的毫秒数
+     * @param spawn_time 子进程启动时刻
+     * @return 毫秒数，不需要定时检查时返回-1
+     */
+    int watchdogWaitMs(Clock::time_point spawn_time) const {
+        Clock::time_point deadline = Clock::time_point::max();
+        if (termination_stage_ == 0) {
+            if (timeout_seconds_ > 0) {
+                deadline = std::min(deadline, spawn_time + toDuration(timeout_seconds_));
+            }
+            if (stall_timeout_seconds_ > 0) {
+                deadline = std::min(deadline, last_advance_time_ + toDuration(stall_timeout_seconds_));
+            }
+        } else if (termination_stage_ < kFinalTerminationStage) {
+            deadline = next_escalation_;
+        }
+        if (deadline == Clock::time_point::max()) {
+            return -1;
+        }
+        long long wait_ms = std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now()).count();
+        return static_cast<int>(std::clamp<long long>(wait_ms, 0, std::numeric_limits<int>::max()));
+    }
+    
+    /**
+     * 升级到下一级终止：中断（FFmpeg会写完文件尾再退出）→ SIGTERM → SIGKILL，作用于整个进程组；
+     * Windows下为CTRL_BREAK事件 → 结束作业对象中的全部进程
+     */
+    void escalateTermination() {
+        termination_stage_++;
+        next_escalation_ = Clock::now() + toDuration(termination_grace_seconds_);
+#ifdef _WIN32
+        // 没有共享控制台时无法发送CTRL_BREAK，直接结束
+        if (termination_stage_ == 1 && GenerateConsoleCtrlEvent(CTRL_BREAK_EVENT, process_info_.dwProcessId)) {
+            return;
+        }
+        termination_stage_ = kFinalTerminationStage;
+        if (job_handle_ != nullptr) {
+            TerminateJobObject(job_handle_, 1);
+        } else {
+            TerminateProcess(process_info_.hProcess, 1);
+        }
+#else
+        static const int kSignals[kFinalTerminationStage] = {SIGINT, SIGTERM, SIGKILL};
+        pid_t pid = child_pid_;
+        if (pid > 0) {
+            kill(-pid, kSignals[termination_stage_ - 1]);
+        }
 #endif
+    }
+    
+    /**
+     * 向进度回调和异步句柄的订阅者发布进度
+     * @param progress 进度快照
+     */
+    void emitProgress(const ProgressEvent& progress) {
+        // 重复的进度块不算进展，不重置停滞计时
+        if (progress.frame > last_advance_.frame || progress.outTimeUs > last_advance_.outTimeUs ||
+            progress.totalSize > last_advance_.totalSize) {
+            last_advance_ = progress;
+            last_advance_time_ = Clock::now();
+        }
+        if (progress_callback_) {
+            progress_callback_(progress);
+        }
+        if (async_state_ != nullptr) {
+            async_state_->publish(progress);
+        }
+    }
     
     /**
      * 内部执行函数
-     * @param command 命令字符串
+     * @param spec 启动描述
      * @param result 执行结果引用
      */
-    void executeInternal(const std::string& command, ExecuteResult& result) {
+    void executeInternal(const LaunchSpec& spec, ExecuteResult& result) {
 #ifdef _WIN32
-        executeWindows(command, result);
+        executeWindows(spec, result);
 #else
-        executeUnix(command, result);
+        executeUnix(spec, result);
 #endif
     }
     
     /**
-     * 检测是否包含覆盖提示
-     * @param line 输出行
-     * @return 是否包含覆盖提示
+     * 检测FFmpeg进度统计行，如 "frame=  120 fps= 30 ... time=00:00:04.00 ... speed=1.2x"
+     * @param line 输出行
+     * @return 是否为进度统计行
+     */
+    bool detectProgress(std::string_view line) {
+        size_t start = line.find_first_not_of(' ');
+        if (start == std::string_view::npos) {
+            return false;
+        }
+        std::string_view stats = line.substr(start);
+        bool stats_prefix = stats.compare(0, 6, "frame=") == 0 ||
+                            stats.compare(0, 5, "size=") == 0;
+        return stats_prefix && stats.find("time=") != std::string_view::npos;
+    }
+    
+    /**
+     * 根据统计行更新进度快照并通知订阅者
+     * @param line 统计行
+     */
+    void updateProgress(std::string_view line) {
+        ProgressEvent progress;
+        {
+            std::lock_guard<std::mutex> lock(progress_mutex_);
+            parseProgressLine(line, latest_progress_);
+            fillEstimates(latest_progress_);
+            progress = latest_progress_;
+        }
+        emitProgress(progress);
+    }
+    
+    /**
+     * 处理 -progress 输出的一行 key=value，遇到 progress=continue/end 时发布一个完整的数据块
+     * @param record 一行进度数据
+     */
+    void processProgressRecord(std::string_view record) {
+        size_t equal_pos = record.find('=');
+        if (equal_pos == std::string_view::npos) {
+            return;
+        }
+        std::string_view key = record.substr(0, equal_pos);
+        std::string_view value = record.substr(equal_pos + 1);
+        size_t value_start = value.find_first_not_of(' ');
+        value = value_start == std::string_view::npos ? std::string_view() : value.substr(value_start);
+        
+        if (key != "progress") {
+            applyProgressField(key, value, pending_progress_);
+            return;
+        }
+        
+        pending_progress_.finished = (value == "end");
+        ProgressEvent progress;
+        {
+            std::lock_guard<std::mutex> lock(progress_mutex_);
+            fillEstimates(pending_progress_);
+            latest_progress_ = pending_progress_;
+            progress = latest_progress_;
+        }
+        emitProgress(progress);
+    }
+    
+    /**
+     * 根据预期时长计算完成百分比和预计剩余时间
+     * @param progress 进度快照
+     */
+    void fillEstimates(ProgressEvent& progress) const {
+        if (expected_duration_us_ <= 0 || progress.outTimeUs < 0) {
+            return;
+        }
+        long long done_us = std::min(progress.outTimeUs, expected_duration_us_);
+        progress.percent = done_us * 100.0 / expected_duration_us_;
+        if (progress.speed > 0) {
+            progress.etaSeconds = (expected_duration_us_ - done_us) / 1000000.0 / progress.speed;
+        }
+    }
+    
+    /**
+     * 解析单个进度字段，同时支持统计行和 -progress 输出中的键
+     * @param key 字段名
+     * @param value 字段值
+     * @param progress 进度快照
+     * @return 是否识别并解析了该字段
      */
-    bool detectOverwritePrompt(const std::string& line) {
-        // 检查常见的覆盖提示模式
-        std::string line_lower = toLower(line);
-        
-        // 模式1: File 'xxx' already exists. Overwrite? [y/N]
-        if (line_lower.find("already exists") != std::string::npos &&
-            line_lower.find("overwrite") != std::string::npos) {
-            return true;
+    static bool applyProgressField(std::string_view key, std::string_view value, ProgressEvent& progress) {
+        if (key == "frame") {
+            return parseNumber(value, progress.frame);
         }
-        
-        // 模式2: Overwrite? (y/n)
-        if (line_lower.find("overwrite?") != std::string::npos ||
-            line_lower.find("overwrite (y/n)") != std::string::npos) {
-            return true;
+        if (key == "fps") {
+            return parseNumber(value, progress.fps);
         }
-        
-        // 模式3: 文件已存在，是否覆盖？(中文提示)
-        if (line.find("已存在") != std::string::npos &&
-            line.find("覆盖") != std::string::npos) {
+        if (key == "total_size") {
+            return parseNumber(value, progress.totalSize);
+        }
+        if (key == "out_time_us" || key == "out_time_ms") {
+            // 历史原因，out_time_ms 的单位同样是微秒
+            return parseNumber(value, progress.outTimeUs);
+        }
+        if (key == "size" || key == "Lsize") {
+            // 统计行中的单位：kB/KiB（1024字节）、MB/MiB、B
+            double size = 0;
+            size_t digits = value.find_first_not_of("0123456789.");
+            if (!parseNumber(value.substr(0, digits), size)) {
+                return false;
+            }
+            std::string_view unit = digits == std::string_view::npos ? std::string_view() : value.substr(digits);
+            double scale = 1;
+            if (unit == "kB" || unit == "KiB") {
+                scale = 1024.0;
+            } else if (unit == "MB" || unit == "MiB") {
+                scale = 1024.0 * 1024.0;
+            } else if (unit == "GB" || unit == "GiB") {
+                scale = 1024.0 * 1024.0 * 1024.0;
+            }
+            progress.totalSize = static_cast<long long>(size * scale);
             return true;
         }
-        
+        if (key == "time" || key == "out_time") {
+            return parseClockTime(value, progress.outTimeUs);
+        }
+        if (key == "bitrate") {
+            // 例如 "2097.2kbits/s"
+            return parseNumber(value.substr(0, value.find("kbits/s")), progress.bitrateKbps);
+        }
+        if (key == "speed") {
+            if (!value.empty() && value.back() == 'x') {
+                value.remove_suffix(1);
+            }
+            return parseNumber(value, progress.speed);
+        }
         return false;
     }
     
     /**
-     * 检测FFmpeg错误
-     * @param line 输出行
-     * @return 是否包含错误信息
+     * 解析数字，"N/A"等无法解析的值返回false且不修改输出
      */
-    bool detectError(const std::string& line) {
-        std::string line_lower = toLower(line);
-        
-        // 常见FFmpeg错误关键词
-        std::vector<std::string> error_keywords = {
-            "error", "failed", "invalid", "unable", "cannot", 
-            "unknown", "not found", "permission denied", "access denied"
-        };
-        
-        for (const auto& keyword : error_keywords) {
-            if (line_lower.find(keyword) != std::string::npos) {
-                // 排除一些误判情况
-                if (line_lower.find("non-monotonous") != std::string::npos) {
-                    // 忽略"non-monotonous DTS"警告
-                    continue;
-                }
-                return true;
-            }
+    template <typename T>
+    static bool parseNumber(std::string_view text, T& value) {
+        T parsed{};
+        auto res = std::from_chars(text.data(), text.data() + text.size(), parsed);
+        if (res.ec != std::errc() || res.ptr == text.data()) {
+            return false;
         }
-        
-        return false;
+        value = parsed;
+        return true;
     }
     
     /**
-     * 检测FFmpeg成功完成
-     * @param line 输出行
-     * @return 是否包含成功完成信息
+     * 解析 "HH:MM:SS.xx" 形式的时间（可带负号）为微秒
      */
-    bool detectSuccess(const std::string& line) {
-        std::string line_lower = toLower(line);
-        
-        // 成功完成的关键词
-        if (line_lower.find("video:") != std::string::npos &&
-            line_lower.find("audio:") != std::string::npos &&
-            line_lower.find("subtitle:") != std::string::npos) {
-            return true;
+    static bool parseClockTime(std::string_view text, long long& time_us) {
+        bool negative = !text.empty() && text.front() == '-';
+        if (negative) {
+            text.remove_prefix(1);
         }
-        
-        // 编码完成提示
-        if (line_lower.find("muxing overhead") != std::string::npos) {
-            return true;
+        double fields[3] = {0, 0, 0};
+        for (int i = 0; i < 3; ++i) {
+            size_t colon = i < 2 ? text.find(':') : text.size();
+            if (colon == std::string_view::npos || !parseNumber(text.substr(0, colon), fields[i])) {
+                return false;
+            }
+            text.remove_prefix(std::min(colon + 1, text.size()));
         }
-        
-        return false;
+        double seconds = fields[0] * 3600 + fields[1] * 60 + fields[2];
+        time_us = static_cast<long long>((negative ? -seconds : seconds) * 1000000.0);
+        return true;
     }
     
     /**
      * 处理输出行
      * @param line 输出行
+     * @param carriage_return 该行是否只以\r结尾
      * @param result 执行结果引用
      */
-    void processLine(const std::string& line, ExecuteResult& result) {
-        {
+    void processLine(std::string_view line, bool carriage_return, ExecuteResult& result) {
+        // -loglevel +level 的标记在统计行前面，如 "[info] frame=  120 ..."
+        std::string_view message;
+        int level = OutputClassifier::parseLevel(line, message);
+        if (detectProgress(message)) {
+            updateProgress(message);
+            // 以\r结尾的统计行只作为进度事件，不进入日志和行回调
+            if (carriage_return) {
+                return;
+            }
+        }
+        
+        if (capture_output_) {
             std::lock_guard<std::mutex> lock(output_mutex_);
-            output_buffer_ += line + "\n";
+            output_log_.append(line);
         }
         
+        if (line_callback_) {
+            line_callback_(line);
+        }
+        
+        countLevel(level, result.logLevels);
+        
+        // 带级别标记时按标记分类，否则一次扫描完成全部关键词分类
+        unsigned line_class = OutputClassifier::instance().classify(line, level, message);
+        
         // 检测覆盖提示
-        if (detectOverwritePrompt(line)) {
+        if (line_class & OutputClassifier::kOverwritePrompt) {
             result.overwritePrompted = true;
             if (auto_overwrite_) {
                 result.overwriteConfirmed = true;
                 sendInput("y\n");
+            } else {
+                // 不回答的话FFmpeg会一直等待标准输入
+                sendInput("n\n");
             }
         }
         
         // 检测错误
-        if (detectError(line)) {
+        if (line_class & OutputClassifier::kError) {
             std::lock_guard<std::mutex> lock(error_mutex_);
-            last_error_ = line;
-            result.error = line;
+            last_error_.assign(message.data(), message.size());
+            result.error = last_error_;
         }
         
         // 检测成功完成
-        if (detectSuccess(line)) {
+        if (line_class & OutputClassifier::kSuccess) {
             result.success = true;
         }
     }
     
+    /**
+     * 把一行计入对应日志级别
+     * @param level OutputClassifier::parseLevel()返回的日志级别
+     * @param counts 各级别行数
+     */
+    static void countLevel(int level, LogLevelCounts& counts) {
+        switch (level) {
+            case OutputClassifier::kLevelPanic:
+            case OutputClassifier::kLevelFatal:
+                counts.fatal++;
+                break;
+            case OutputClassifier::kLevelError:
+                counts.error++;
+                break;
+            case OutputClassifier::kLevelWarning:
+                counts.warning++;
+                break;
+            case OutputClassifier::kLevelInfo:
+                counts.info++;
+                break;
+            case OutputClassifier::kLevelNone:
+                counts.untagged++;
+                break;
+            default:
+                counts.verbose++;
+                break;
+        }
+    }
+    
     /**
      * 发送输入到进程
      * @param input 输入字符串
@@ -290,19 +1807,45 @@ private:
 #endif
     }
     
+#ifdef _WIN32
     /**
-     * 字符串转小写
-     * @param str 输入字符串
-     * @return 小写字符串
+     * 按CommandLineToArgvW的规则拼接命令行
+     * @param argv 参数数组
+     * @return 命令行字符串
      */
-    std::string toLower(const std::string& str) {
-        std::string result = str;
-        std::transform(result.begin(), result.end(), result.begin(),
-                      [](unsigned char c) { return std::tolower(c); });
-        return result;
+    static std::string buildWindowsCommandLine(const std::vector<std::string>& argv) {
+        std::string cmd_line;
+        for (size_t i = 0; i < argv.size(); ++i) {
+            if (i > 0) {
+                cmd_line += ' ';
+            }
+            const std::string& arg = argv[i];
+            if (!arg.empty() && arg.find_first_of(" \t\"") == std::string::npos) {
+                cmd_line += arg;
+                continue;
+            }
+            // 引号前的反斜杠需要加倍，引号本身需要转义
+            cmd_line += '"';
+            size_t backslashes = 0;
+            for (char c : arg) {
+                if (c == '\\') {
+                    backslashes++;
+                    continue;
+                }
+                if (c == '"') {
+                    cmd_line.append(backslashes * 2 + 1, '\\');
+                } else {
+                    cmd_line.append(backslashes, '\\');
+                }
+                backslashes = 0;
+                cmd_line += c;
+            }
+            cmd_line.append(backslashes * 2, '\\');
+            cmd_line += '"';
+        }
+        return cmd_line;
     }
     
-#ifdef _WIN32
     /**
      * Windows平台执行
      */
@@ -335,15 +1878,46 @@ private:
         // 创建命令行字符串
         std::string cmd_str = command;
         
-        // 创建进程
+        if (cgroup_limits_.enabled) {
+            result.cgroup.error = "当前平台不支持cgroup";
+        }
+        
+        // 子进程及其后代放入作业对象，终止时整体结束，执行器所在进程退出时也不会留下孤儿进程
+        job_handle_ = CreateJobObjectA(nullptr, nullptr);
+        if (job_handle_ != nullptr) {
+            JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits = {};
+            limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+            SetInformationJobObject(job_handle_, JobObjectExtendedLimitInformation, &limits, sizeof(limits));
+        }
+        
+        // 创建进程：先挂起，加入作业对象后再恢复，避免后代进程逃出作业；
+        // 独立的进程组使CTRL_BREAK事件只发给该任务
         if (!CreateProcessA(nullptr, const_cast<LPSTR>(cmd_str.c_str()), nullptr, nullptr, 
-                           TRUE, 0, nullptr, nullptr, &startup_info, &process_info_)) {
+                           TRUE, CREATE_SUSPENDED | CREATE_NEW_PROCESS_GROUP, nullptr, nullptr,
+                           &startup_info, &process_info_)) {
             DWORD error_code = GetLastError();
             result.error = "创建进程失败: 错误代码 " + std::to_string(error_code);
             cleanupWindowsHandles();
             is_running_ = false;
             return;
         }
+        if (job_handle_ != nullptr) {
+            AssignProcessToJobObject(job_handle_, process_info_.hProcess);
+        }
+        if (!cpu_affinity_.empty()) {
+            DWORD_PTR mask = 0;
+            for (int cpu : cpu_affinity_) {
+                if (cpu >= 0 && cpu < static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+                    mask |= static_cast<DWORD_PTR>(1) << cpu;
+                }
+            }
+            if (mask != 0) {
+                SetProcessAffinityMask(process_info_.hProcess, mask);
+            }
+        }
+        ResumeThread(process_info_.hThread);
+        Clock::time_point spawn_time = Clock::now();
+        startWatchdog(spawn_time);
         
         // 关闭不需要的句柄
         CloseHandle(stdout_write_handle_);
@@ -352,11 +1926,11 @@ private:
         stdin_read_handle_ = nullptr;
         
         // 读取输出
-        char buffer[4096];
         DWORD bytes_read = 0;
-        std::string remaining_output;
         
-        while (is_running_) {
+        while (true) {
+            checkWatchdog(spawn_time, result);
+            
             // 检查进程是否已退出
             DWORD exit_code = 0;
             if (GetExitCodeProcess(process_info_.hProcess, &exit_code)) {
@@ -368,9 +1942,11 @@ private:
             
             // 读取输出
             if (PeekNamedPipe(stdout_read_handle_, nullptr, 0, nullptr, &bytes_read, nullptr) && bytes_read > 0) {
-                if (ReadFile(stdout_read_handle_, buffer, sizeof(buffer) - 1, &bytes_read, nullptr) && bytes_read > 0) {
-                    buffer[bytes_read] = '\0';
-                    processOutput(buffer, remaining_output, result);
+                if (result.usage.firstOutputSeconds < 0) {
+                    result.usage.firstOutputSeconds = secondsSince(spawn_time);
+                }
+                if (readWindowsPipe(bytes_read)) {
+                    processOutput(result);
                 }
             }
             
@@ -379,10 +1955,10 @@ private:
         }
         
         // 读取剩余输出
-        while (ReadFile(stdout_read_handle_, buffer, sizeof(buffer) - 1, &bytes_read, nullptr) && bytes_read > 0) {
-            buffer[bytes_read] = '\0';
-            processOutput(buffer, remaining_output, result);
+        while (readWindowsPipe(bytes_read)) {
+            processOutput(result);
         }
+        flushOutput(result);
         
         // 获取最终退出码
         DWORD exit_code = 0;
@@ -394,14 +1970,70 @@ private:
             }
         }
         
+        // 被终止时结束作业中残留的后代进程
+        if (termination_stage_ > 0 && job_handle_ != nullptr) {
+            TerminateJobObject(job_handle_, 1);
+        }
+        
+        // 统计资源消耗
+        WaitForSingleObject(process_info_.hProcess, INFINITE);
+        result.usage.wallSeconds = secondsSince(spawn_time);
+        collectWindowsUsage(process_info_.hProcess, result.usage);
+        
         // 清理
         cleanupWindowsHandles();
         
         // 设置最终输出
         {
             std::lock_guard<std::mutex> lock(output_mutex_);
-            result.output = output_buffer_;
+            result.output = output_log_.str();
+            result.outputDroppedBytes = output_log_.droppedBytes();
+            output_log_.clear();
+        }
+    }
+    
+    /**
+     * 读取已退出进程的CPU时间、峰值内存和I/O统计
+     * @param process 进程句柄
+     * @param usage 资源消耗
+     */
+    static void collectWindowsUsage(HANDLE process, ResourceUsage& usage) {
+        // FILETIME以100纳秒为单位
+        auto toSeconds = [](const FILETIME& time) {
+            ULARGE_INTEGER value;
+            value.LowPart = time.dwLowDateTime;
+            value.HighPart = time.dwHighDateTime;
+            return value.QuadPart / 10000000.0;
+        };
+        FILETIME creation_time, exit_time, kernel_time, user_time;
+        if (GetProcessTimes(process, &creation_time, &exit_time, &kernel_time, &user_time)) {
+            usage.userCpuSeconds = toSeconds(user_time);
+            usage.systemCpuSeconds = toSeconds(kernel_time);
+        }
+        PROCESS_MEMORY_COUNTERS memory = {};
+        if (K32GetProcessMemoryInfo(process, &memory, sizeof(memory))) {
+            usage.maxRssKb = static_cast<long long>(memory.PeakWorkingSetSize / 1024);
+        }
+        IO_COUNTERS io = {};
+        if (GetProcessIoCounters(process, &io)) {
+            usage.bytesRead = static_cast<long long>(io.ReadTransferCount);
+            usage.bytesWritten = static_cast<long long>(io.WriteTransferCount);
+        }
+    }
+    
+    /**
+     * 从输出管道直接读入分帧缓冲区
+     * @param bytes_read 实际读取的字节数
+     * @return 是否读到数据
+     */
+    bool readWindowsPipe(DWORD& bytes_read) {
+        char* dest = output_framer_.writePtr();
+        DWORD space = static_cast<DWORD>(output_framer_.writeSpace());
+        if (ReadFile(stdout_read_handle_, dest, space, &bytes_read, nullptr) && bytes_read > 0) {
+            output_framer_.commit(bytes_read);
+            return true;
         }
+        return false;
     }
     
     /**
@@ -432,120 +2064,424 @@ private:
             CloseHandle(process_info_.hThread);
             process_info_.hThread = nullptr;
         }
+        if (job_handle_ != nullptr) {
+            CloseHandle(job_handle_);
+            job_handle_ = nullptr;
+        }
     }
 #else
+    /**
+     * 创建带close-on-exec标志的管道，避免并发启动的其他子进程继承
+     * @param fds 管道描述符
+     * @return 是否成功
+     */
+    static bool createPipe(int fds[2]) {
+#ifdef __linux__
+        return pipe2(fds, O_CLOEXEC) == 0;
+#else
+        if (pipe(fds) == -1) {
+            return false;
+        }
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        return true;
+#endif
+    }
+    
     /**
      * Unix/Linux平台执行
+     * 使用posix_spawn启动（glibc内部为vfork语义），不复制父进程地址空间
      */
-    void executeUnix(const std::string& command, ExecuteResult& result) {
+    void executeUnix(const std::vector<std::string>& argv, ExecuteResult& result) {
         // 创建标准输出管道
-        if (pipe(stdout_pipe_) == -1) {
+        if (!createPipe(stdout_pipe_)) {
             result.error = "创建输出管道失败";
             is_running_ = false;
             return;
         }
         
-        // 创建标准输入管道
-        if (pipe(stdin_pipe_) == -1) {
+        // 创建标准输入管道（标准输入被重定向时不需要）
+        if (stdio_redirect_[0] == -1 && !createPipe(stdin_pipe_)) {
             result.error = "创建输入管道失败";
-            close(stdout_pipe_[0]);
-            close(stdout_pipe_[1]);
+            cleanupUnixPipes();
             is_running_ = false;
             return;
         }
         
+        // 创建进度管道；写入端恰好是kProgressFd时dup2不会清除close-on-exec，先挪开
+        if (use_progress_fd_) {
+            if (!createPipe(progress_pipe_)) {
+                result.error = "创建进度管道失败";
+                cleanupUnixPipes();
+                is_running_ = false;
+                return;
+            }
+            if (progress_pipe_[1] == kProgressFd) {
+                int moved = fcntl(progress_pipe_[1], F_DUPFD_CLOEXEC, kProgressFd + 1);
+                close(progress_pipe_[1]);
+                progress_pipe_[1] = moved;
+            }
+        }
+        
+        // 重定向子进程的标准输入、输出和错误（dup2会清除close-on-exec标志）
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, stdio_redirect_[1] != -1 ? stdio_redirect_[1] : stdout_pipe_[1],
+                                         STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, stdout_pipe_[1], STDERR_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, stdio_redirect_[0] != -1 ? stdio_redirect_[0] : stdin_pipe_[0],
+                                         STDIN_FILENO);
+        if (progress_pipe_[1] != -1) {
+            posix_spawn_file_actions_adddup2(&actions, progress_pipe_[1], kProgressFd);
+        }
+        
+        // 丢弃上一个任务结束后才到达的stop()唤醒
+        drainWakePipe();
+        
+        // 建立cgroup子组，失败时不受限制地运行
+        CgroupEnvelope envelope;
+        if (cgroup_limits_.enabled) {
+            envelope.create(cgroup_limits_, result.cgroup);
+        }
+        
+        std::vector<char*> c_argv;
+        c_argv.reserve(argv.size() + 1);
+        for (const auto& arg : argv) {
+            c_argv.push_back(const_cast<char*>(arg.c_str()));
+        }
+        c_argv.push_back(nullptr);
+        
+        // 子进程自成一个进程组，终止时连同它启动的后代进程一起发送信号
+        posix_spawnattr_t attr;
+        posix_spawnattr_init(&attr);
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+        posix_spawnattr_setpgroup(&attr, 0);
+        
+#ifdef __linux__
+        // posix_spawn没有亲和性属性，子进程继承调用线程的亲和性：启动期间临时绑定当前线程
+        cpu_set_t saved_affinity;
+        bool pinned = !cpu_affinity_.empty() && pinCallingThread(cpu_affinity_, saved_affinity);
+#endif
+        
         // 创建子进程
-        child_pid_ = fork();
+        pid_t pid = -1;
+        int spawn_error = posix_spawnp(&pid, c_argv[0], &actions, &attr, c_argv.data(), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        posix_spawnattr_destroy(&attr);
+#ifdef __linux__
+        if (pinned) {
+            sched_setaffinity(0, sizeof(saved_affinity), &saved_affinity);
+        }
+#endif
         
-        if (child_pid_ == -1) {
-            result.error = "创建子进程失败";
+        if (spawn_error != 0) {
+            result.error = "创建子进程失败: " + std::string(strerror(spawn_error));
             cleanupUnixPipes();
             is_running_ = false;
             return;
         }
+        child_pid_ = pid;
+        Clock::time_point spawn_time = Clock::now();
+        startWatchdog(spawn_time);
+        envelope.attach(pid, result.cgroup);
         
-        if (child_pid_ == 0) {
-            // 子进程
-            close(stdout_pipe_[0]); // 关闭读取端
-            close(stdin_pipe_[1]);  // 关闭写入端
-            
-            // 重定向标准输出和错误
-            dup2(stdout_pipe_[1], STDOUT_FILENO);
-            dup2(stdout_pipe_[1], STDERR_FILENO);
-            
-            // 重定向标准输入
-            dup2(stdin_pipe_[0], STDIN_FILENO);
-            
-            // 关闭不需要的文件描述符
-            close(stdout_pipe_[1]);
-            close(stdin_pipe_[0]);
-            
-            // 执行命令
-            execl("/bin/sh", "sh", "-c", command.c_str(), nullptr);
-            
-            // 如果exec失败
-            exit(EXIT_FAILURE);
-        } else {
-            // 父进程
-            close(stdout_pipe_[1]); // 关闭写入端
+        // 父进程
+        close(stdout_pipe_[1]); // 关闭写入端
+        stdout_pipe_[1] = -1;
+        if (stdin_pipe_[0] != -1) {
             close(stdin_pipe_[0]);  // 关闭读取端
+            stdin_pipe_[0] = -1;
+        }
+        closeStdioRedirect();
+        if (progress_pipe_[1] != -1) {
+            close(progress_pipe_[1]);
+            progress_pipe_[1] = -1;
+        }
+        
+        // 设置为非阻塞读取
+        setNonBlocking(stdout_pipe_[0]);
+        if (progress_pipe_[0] != -1) {
+            setNonBlocking(progress_pipe_[0]);
+        }
+        progress_framer_.clear();
+        
+        auto on_output = [&](std::string_view line, bool carriage_return) {
+            processLine(line, carriage_return, result);
+        };
+        auto on_progress = [&](std::string_view record, bool) {
+            processProgressRecord(record);
+        };
+        
+        // 优先用pidfd感知子进程退出，不可用时退化为定时检查
+        int pid_fd = openPidFd(child_pid_);
+        
+        bool pipe_open = true;
+        bool progress_open = progress_pipe_[0] != -1;
+        bool exited = false;
+        int status = 0;
+        
+        // 阻塞在poll上，直到有输出、子进程退出、stop()唤醒或看门狗到期才醒来
+        while (!exited) {
+            checkWatchdog(spawn_time, result);
             
-            // 设置为非阻塞读取
-            int flags = fcntl(stdout_pipe_[0], F_GETFL, 0);
-            fcntl(stdout_pipe_[0], F_SETFL, flags | O_NONBLOCK);
-            
-            // 读取输出
-            char buffer[4096];
-            ssize_t bytes_read = 0;
-            std::string remaining_output;
+            struct pollfd fds[4];
+            nfds_t nfds = 0;
+            int output_index = -1;
+            int progress_index = -1;
+            int pid_index = -1;
+            int wake_index = -1;
+            auto watch = [&](int fd) {
+                fds[nfds].fd = fd;
+                fds[nfds].events = POLLIN;
+                fds[nfds].revents = 0;
+                return static_cast<int>(nfds++);
+            };
+            if (pipe_open) {
+                output_index = watch(stdout_pipe_[0]);
+            }
+            if (progress_open) {
+                progress_index = watch(progress_pipe_[0]);
+            }
+            if (pid_fd != -1) {
+                pid_index = watch(pid_fd);
+            }
+            if (wake_pipe_[0] != -1) {
+                wake_index = watch(wake_pipe_[0]);
+            }
             
-            while (is_running_) {
-                // 检查子进程是否已退出
-                int status = 0;
-                pid_t wait_result = waitpid(child_pid_, &status, WNOHANG);
-                
-                if (wait_result != 0) {
-                    // 子进程已退出
-                    if (WIFEXITED(status)) {
-                        result.exitCode = WEXITSTATUS(status);
-                        // 如果退出码为0，认为是成功
-                        if (result.exitCode == 0 && !result.success) {
-                            result.success = true;
-                        }
-                    } else {
-                        result.exitCode = -1;
-                    }
-                    break;
-                }
-                
-                // 读取输出
-                bytes_read = read(stdout_pipe_[0], buffer, sizeof(buffer) - 1);
-                
-                if (bytes_read > 0) {
-                    buffer[bytes_read] = '\0';
-                    processOutput(buffer, remaining_output, result);
-                } else if (bytes_read < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
-                    // 读取错误
-                    break;
+            int wait_ms = watchdogWaitMs(spawn_time);
+            if (pid_fd == -1 && (wait_ms < 0 || wait_ms > kExitCheckIntervalMs)) {
+                wait_ms = kExitCheckIntervalMs;
+            }
+            int ready = poll(fds, nfds, wait_ms);
+            if (ready < 0) {
+                if (errno == EINTR) {
+                    continue;
                 }
-                
-                // 短暂休眠，避免CPU占用过高
-                usleep(10000); // 10ms
+                break;
             }
             
-            // 读取剩余输出
-            while ((bytes_read = read(stdout_pipe_[0], buffer, sizeof(buffer) - 1)) > 0) {
-                buffer[bytes_read] = '\0';
-                processOutput(buffer, remaining_output, result);
+            // 读取输出，读到EOF说明子进程一侧已全部关闭
+            const short readable = POLLIN | POLLHUP | POLLERR;
+            if (output_index != -1 && (fds[output_index].revents & readable)) {
+                if (result.usage.firstOutputSeconds < 0 && (fds[output_index].revents & POLLIN)) {
+                    result.usage.firstOutputSeconds = secondsSince(spawn_time);
+                }
+                pipe_open = drainPipe(stdout_pipe_[0], output_framer_, on_output);
+                flushPendingPrompt(on_output);
+            }
+            if (progress_index != -1 && (fds[progress_index].revents & readable)) {
+                progress_open = drainPipe(progress_pipe_[0], progress_framer_, on_progress);
+            }
+            if (wake_index != -1 && (fds[wake_index].revents & POLLIN)) {
+                drainWakePipe();
             }
             
-            // 清理
-            cleanupUnixPipes();
-            
-            // 设置最终输出
-            {
-                std::lock_guard<std::mutex> lock(output_mutex_);
-                result.output = output_buffer_;
+            // 检查子进程是否已退出
+            bool exit_signaled = pid_index != -1 && (fds[pid_index].revents & POLLIN);
+            if (pid_fd == -1 || exit_signaled) {
+                exited = waitChildExit(false);
+            }
+        }
+        
+        if (pid_fd != -1) {
+            close(pid_fd);
+        }
+        
+        // poll出错时，等待子进程真正结束
+        if (!exited) {
+            waitChildExit(true);
+        }
+        
+        // 被终止时清理进程组中残留的后代进程；组长尚未回收，进程组号不会被复用
+        if (termination_stage_ > 0) {
+            kill(-child_pid_.load(), SIGKILL);
+        }
+        
+        // 子进程此时是僵尸进程，先读取/proc/<pid>/io再回收，回收时取得rusage
+        readProcIo(child_pid_, result.usage);
+        struct rusage usage = {};
+        while (wait4(child_pid_, &status, 0, &usage) == -1 && errno == EINTR) {
+        }
+        result.usage.wallSeconds = secondsSince(spawn_time);
+        result.usage.userCpuSeconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0;
+        result.usage.systemCpuSeconds = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+#ifdef __APPLE__
+        result.usage.maxRssKb = usage.ru_maxrss / 1024;
+#else
+        result.usage.maxRssKb = usage.ru_maxrss;
+#endif
+        envelope.collect(result.cgroup);
+        
+        if (WIFEXITED(status)) {
+            result.exitCode = WEXITSTATUS(status);
+            // 如果退出码为0，认为是成功
+            if (result.exitCode == 0 && !result.success) {
+                result.success = true;
+            }
+        } else {
+            result.exitCode = -1;
+        }
+        
+        // 读取剩余输出
+        if (pipe_open) {
+            drainPipe(stdout_pipe_[0], output_framer_, on_output);
+        }
+        flushOutput(result);
+        if (progress_open) {
+            drainPipe(progress_pipe_[0], progress_framer_, on_progress);
+        }
+        progress_framer_.finish(on_progress);
+        
+        // 清理
+        cleanupUnixPipes();
+        child_pid_ = -1;
+        
+        // 设置最终输出
+        {
+            std::lock_guard<std::mutex> lock(output_mutex_);
+            result.output = output_log_.str();
+            result.outputDroppedBytes = output_log_.droppedBytes();
+            output_log_.clear();
+        }
+    }
+    
+    /**
+     * 读取非阻塞管道中当前可读的全部数据，直接读入分帧缓冲区并逐条分发
+     * @param fd 管道读取端
+     * @param framer 分帧缓冲区
+     * @param on_record 记录回调 void(std::string_view, bool)
+     * @return 管道是否仍然打开（读到EOF或出错时返回false）
+     */
+    template <typename OnRecord>
+    static bool drainPipe(int fd, LineFramer& framer, OnRecord&& on_record) {
+        while (true) {
+            char* dest = framer.writePtr();
+            ssize_t bytes_read = read(fd, dest, framer.writeSpace());
+            if (bytes_read > 0) {
+                framer.commit(static_cast<size_t>(bytes_read));
+                framer.drain(on_record);
+                continue;
+            }
+            if (bytes_read == 0) {
+                return false;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+    }
+    
+    /**
+     * 等待子进程退出但不回收（WNOWAIT），使其/proc/<pid>/io仍可读取
+     * @param block 是否阻塞等待
+     * @return 子进程是否已退出（出错时也返回true，交由回收处理）
+     */
+    bool waitChildExit(bool block) {
+        while (true) {
+            siginfo_t info;
+            std::memset(&info, 0, sizeof(info));
+            int options = WEXITED | WNOWAIT | (block ? 0 : WNOHANG);
+            if (waitid(P_PID, static_cast<id_t>(child_pid_.load()), &info, options) == 0) {
+                return info.si_pid != 0;
+            }
+            if (errno != EINTR) {
+                return true;
+            }
+        }
+    }
+    
+    /**
+     * 读取/proc/<pid>/io中的I/O统计（仅Linux）
+     * @param pid 进程ID
+     * @param usage 资源消耗
+     */
+    static void readProcIo(pid_t pid, ResourceUsage& usage) {
+        std::string path = "/proc/" + std::to_string(pid) + "/io";
+        FILE* file = std::fopen(path.c_str(), "r");
+        if (file == nullptr) {
+            return;
+        }
+        char key[32];
+        long long value = 0;
+        while (std::fscanf(file, "%31[^:]: %lld\n", key, &value) == 2) {
+            std::string_view name(key);
+            if (name == "rchar") {
+                usage.bytesRead = value;
+            } else if (name == "wchar") {
+                usage.bytesWritten = value;
+            } else if (name == "read_bytes") {
+                usage.storageBytesRead = value;
+            } else if (name == "write_bytes") {
+                usage.storageBytesWritten = value;
+            }
+        }
+        std::fclose(file);
+    }
+    
+#ifdef __linux__
+    /**
+     * 把调用线程绑定到一组CPU上
+     * @param cpus CPU编号
+     * @param previous 原来的亲和性，用于恢复
+     * @return 是否已绑定
+     */
+    static bool pinCallingThread(const std::vector<int>& cpus, cpu_set_t& previous) {
+        if (sched_getaffinity(0, sizeof(previous), &previous) != 0) {
+            return false;
+        }
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        for (int cpu : cpus) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &mask);
+            }
+        }
+        return CPU_COUNT(&mask) > 0 && sched_setaffinity(0, sizeof(mask), &mask) == 0;
+    }
+#endif
+    
+    /**
+     * 清空唤醒管道
+     */
+    void drainWakePipe() {
+        char buffer[64];
+        while (wake_pipe_[0] != -1 && read(wake_pipe_[0], buffer, sizeof(buffer)) > 0) {
+        }
+    }
+    
+    /**
+     * 把描述符设为非阻塞
+     * @param fd 描述符
+     */
+    static void setNonBlocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    }
+    
+    /**
+     * 为子进程打开pidfd（Linux 5.3+），子进程退出时该描述符变为可读
+     * @param pid 子进程ID
+     * @return pidfd，不支持时返回-1
+     */
+    static int openPidFd(pid_t pid) {
+#if defined(__linux__) && defined(SYS_pidfd_open)
+        return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+        (void)pid;
+        return -1;
+#endif
+    }
+    
+    /**
+     * 关闭尚未交给子进程的标准输入输出重定向描述符
+     */
+    void closeStdioRedirect() {
+        for (int& fd : stdio_redirect_) {
+            if (fd != -1) {
+                close(fd);
+                fd = -1;
             }
         }
     }
@@ -554,6 +2490,7 @@ private:
      * 清理Unix管道
      */
     void cleanupUnixPipes() {
+        closeStdioRedirect();
         if (stdout_pipe_[0] != -1) {
             close(stdout_pipe_[0]);
             stdout_pipe_[0] = -1;
@@ -570,35 +2507,54 @@ private:
             close(stdin_pipe_[1]);
             stdin_pipe_[1] = -1;
         }
+        if (progress_pipe_[0] != -1) {
+            close(progress_pipe_[0]);
+            progress_pipe_[0] = -1;
+        }
+        if (progress_pipe_[1] != -1) {
+            close(progress_pipe_[1]);
+            progress_pipe_[1] = -1;
+        }
     }
 #endif
     
     /**
-     * 处理原始输出，分割为行
-     * @param output 原始输出
-     * @param remaining 剩余未处理的字符串
+     * 处理分帧缓冲区中已读入的输出，逐行分发
      * @param result 执行结果引用
      */
-    void processOutput(const char* output, std::string& remaining, ExecuteResult& result) {
-        std::string full_output = remaining + output;
-        std::string line;
-        size_t start_pos = 0;
-        size_t newline_pos;
-        
-        while ((newline_pos = full_output.find('\n', start_pos)) != std::string::npos) {
-            line = full_output.substr(start_pos, newline_pos - start_pos);
-            
-            // 移除回车符
-            if (!line.empty() && line.back() == '\r') {
-                line.pop_back();
-            }
-            
-            processLine(line, result);
-            start_pos = newline_pos + 1;
+    void processOutput(ExecuteResult& result) {
+        auto on_output = [&](std::string_view line, bool carriage_return) {
+            processLine(line, carriage_return, result);
+        };
+        output_framer_.drain(on_output);
+        flushPendingPrompt(on_output);
+    }
+    
+    /**
+     * FFmpeg的覆盖提示 "File 'x' already exists. Overwrite? [y/N] " 不以换行结尾，
+     * 会一直作为半行留在分帧缓冲区里，而FFmpeg在等待回答。半行是覆盖提示时把它作为完整的一行交出
+     * @param on_output 记录回调 void(std::string_view, bool)
+     */
+    template <typename OnLine>
+    void flushPendingPrompt(OnLine&& on_output) {
+        std::string_view pending = output_framer_.pending();
+        size_t last = pending.find_last_not_of(' ');
+        if (last == std::string_view::npos || (pending[last] != ']' && pending[last] != ')' && pending[last] != '?')) {
+            return;
         }
-        
-        // 保存剩余部分
-        remaining = full_output.substr(start_pos);
+        if (OutputClassifier::instance().classify(pending) & OutputClassifier::kOverwritePrompt) {
+            output_framer_.finish(on_output);
+        }
+    }
+    
+    /**
+     * 处理进程结束后末尾没有换行符的剩余输出
+     * @param result 执行结果引用
+     */
+    void flushOutput(ExecuteResult& result) {
+        output_framer_.finish([&](std::string_view line, bool carriage_return) {
+            processLine(line, carriage_return, result);
+        });
     }
 };
 
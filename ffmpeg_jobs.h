@@ -0,0 +1,1434 @@
+/**
+ * ffmpeg_jobs.h
+ * 常用FFmpeg任务的参数构建
+ * 功能：一次解码、多路输出的任务：格式转换、提取音频、封面帧、低分辨率代理共用同一个输入和同一次解码，
+ *       需要滤镜的视频分支用 split 从解码后的视频流分出；运行后按输出汇报各自的结果。
+ *       分段并行编码：按关键帧把长视频切成若干段，在执行器池中并行编码后用 concat 拼接并校验时长和帧数。
+ *       格式转换：按输出容器的编码兼容表逐路决定流复制还是重新编码，只换容器时直接复制。
+ *       提取音频：一次解封装把所有音轨分别写出，能复制就复制，多个文件在执行器池中并行
+ */
+
+#ifndef FFMPEG_JOBS_H
+#define FFMPEG_JOBS_H
+
+#include "ffmpeg_executor.h"
+#include "executor_pool.h"
+#include "media_probe.h"
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <set>
+
+class MultiOutputJob {
+public:
+    /**
+     * 输出类型
+     */
+    enum class OutputKind {
+        CONVERT,        // 格式转换：第一路视频和第一路音频，编码器按输出容器的默认值
+        EXTRACT_AUDIO,  // 提取一路音频（默认第一路）
+        POSTER_FRAME,   // 在指定时间截取一帧图片（从共用的解码中截取，不按时间跳转）
+        PROXY           // 低分辨率代理视频（libx264 veryfast + aac）
+    };
+
+    /**
+     * 一路输出的描述
+     */
+    struct OutputSpec {
+        OutputKind kind = OutputKind::CONVERT;
+        std::string path;                       // 输出文件路径
+        double posterTimeSeconds = 0;           // 封面帧的时间点（秒）
+        int proxyHeight = 360;                  // 代理视频的高度，宽度按比例取偶数
+        int audioTrack = 0;                     // 提取音频时的音轨序号（第几路音频，从0开始）
+        std::vector<std::string> extraArgs;     // 附加的输出参数，放在默认参数之后，可覆盖默认的编码器设置
+    };
+
+    /**
+     * 一路输出的结果
+     */
+    struct OutputStatus {
+        std::string path;
+        bool success = false;                   // 命令成功、没有归属于该输出的错误且文件非空
+        long long bytes = -1;                   // 输出文件大小，文件不存在时为-1
+        std::string error;                      // 归属于该输出的最后一条错误，或命令整体的错误
+    };
+
+    /**
+     * 任务的结果
+     */
+    struct MultiOutputResult {
+        bool success = false;                   // 是否所有输出都成功
+        std::vector<OutputStatus> outputs;      // 顺序与添加顺序一致
+        FFmpegExecutor::ExecuteResult execution;
+    };
+
+    /**
+     * 构造函数
+     * @param input 输入文件路径
+     * @param ffmpeg FFmpeg可执行文件路径
+     */
+    explicit MultiOutputJob(std::string input, std::string ffmpeg = "ffmpeg")
+        : input_(std::move(input)), ffmpeg_(std::move(ffmpeg)) {}
+
+    /**
+     * 添加一路输出
+     * @param spec 输出描述
+     * @return 输出编号（即FFmpeg的输出文件编号）
+     */
+    size_t addOutput(OutputSpec spec) {
+        outputs_.push_back(std::move(spec));
+        return outputs_.size() - 1;
+    }
+
+    /**
+     * 添加格式转换输出
+     * @param path 输出文件路径
+     * @param extra_args 附加的输出参数，如 {"-c:v", "libx265"}
+     * @return 输出编号
+     */
+    size_t addConvert(const std::string& path, std::vector<std::string> extra_args = {}) {
+        OutputSpec spec;
+        spec.kind = OutputKind::CONVERT;
+        spec.path = path;
+        spec.extraArgs = std::move(extra_args);
+        return addOutput(std::move(spec));
+    }
+
+    /**
+     * 添加提取音频输出
+     * @param path 输出文件路径，编码器按扩展名选择
+     * @param extra_args 附加的输出参数，如 {"-c:a", "copy"}
+     * @param track 音轨序号（第几路音频，从0开始）
+     * @return 输出编号
+     */
+    size_t addAudio(const std::string& path, std::vector<std::string> extra_args = {}, int track = 0) {
+        OutputSpec spec;
+        spec.kind = OutputKind::EXTRACT_AUDIO;
+        spec.path = path;
+        spec.audioTrack = track;
+        spec.extraArgs = std::move(extra_args);
+        return addOutput(std::move(spec));
+    }
+
+    /**
+     * 添加封面帧输出
+     * 封面帧取自共用的解码，不像单独截图那样用 -ss 跳转：开头到截取时间点的帧都要解码。
+     * 同一任务中有其他需要完整解码的视频输出（转换、代理）时这部分解码本来就要做，没有额外开销；
+     * 只截封面时时间点越靠后越慢，应单独用 ffmpeg -ss T -i in -frames:v 1 截取
+     * @param path 图片路径，如 poster.jpg
+     * @param time_seconds 截取的时间点（秒）
+     * @return 输出编号
+     */
+    size_t addPosterFrame(const std::string& path, double time_seconds = 0) {
+        OutputSpec spec;
+        spec.kind = OutputKind::POSTER_FRAME;
+        spec.path = path;
+        spec.posterTimeSeconds = time_seconds;
+        return addOutput(std::move(spec));
+    }
+
+    /**
+     * 添加低分辨率代理输出
+     * @param path 输出文件路径
+     * @param height 视频高度
+     * @return 输出编号
+     */
+    size_t addProxy(const std::string& path, int height = 360) {
+        OutputSpec spec;
+        spec.kind = OutputKind::PROXY;
+        spec.path = path;
+        spec.proxyHeight = height;
+        return addOutput(std::move(spec));
+    }
+
+    /**
+     * 获取已添加的输出
+     * @return 输出描述
+     */
+    const std::vector<OutputSpec>& outputs() const {
+        return outputs_;
+    }
+
+    /**
+     * 构建完整的FFmpeg参数数组
+     * 输入只解码一次：需要滤镜的视频分支（封面帧、代理）在 -filter_complex 中由 split 分出，
+     * 其余输出直接映射输入流，FFmpeg把同一个解码器的输出交给所有用到该流的编码器。
+     * 音频用可选映射（0:a:0?）而不是 asplit，没有音轨的输入也能转换
+     * @return 参数数组，argv[0]为FFmpeg路径
+     */
+    std::vector<std::string> buildArgs() const {
+        std::vector<std::string> args = {ffmpeg_, "-i", input_};
+
+        // 滤镜分支：每个需要滤镜的输出对应一个标签 [pN]
+        std::vector<std::string> branches;
+        std::vector<std::string> labels(outputs_.size());
+        for (size_t i = 0; i < outputs_.size(); ++i) {
+            const OutputSpec& spec = outputs_[i];
+            std::string filter;
+            if (spec.kind == OutputKind::POSTER_FRAME) {
+                // 第二个trim只放过一帧就结束该分支，split不再向它送帧，分支上也不会一直处理到文件结尾
+                filter = "trim=start=" + formatSeconds(spec.posterTimeSeconds) + ",trim=end_frame=1";
+            } else if (spec.kind == OutputKind::PROXY) {
+                filter = "scale=-2:" + std::to_string(spec.proxyHeight);
+            } else {
+                continue;
+            }
+            labels[i] = "[p" + std::to_string(i) + "]";
+            branches.push_back(filter + labels[i]);
+        }
+        if (branches.size() == 1) {
+            args.insert(args.end(), {"-filter_complex", "[0:v:0]" + branches[0]});
+        } else if (branches.size() > 1) {
+            std::string graph = "[0:v:0]split=" + std::to_string(branches.size());
+            for (size_t b = 0; b < branches.size(); ++b) {
+                graph += "[s" + std::to_string(b) + "]";
+            }
+            for (size_t b = 0; b < branches.size(); ++b) {
+                graph += ";[s" + std::to_string(b) + "]" + branches[b];
+            }
+            args.insert(args.end(), {"-filter_complex", graph});
+        }
+
+        for (size_t i = 0; i < outputs_.size(); ++i) {
+            const OutputSpec& spec = outputs_[i];
+            switch (spec.kind) {
+                case OutputKind::CONVERT:
+                    args.insert(args.end(), {"-map", "0:v:0?", "-map", "0:a:0?"});
+                    break;
+                case OutputKind::EXTRACT_AUDIO:
+                    args.insert(args.end(), {"-map", "0:a:" + std::to_string(spec.audioTrack)});
+                    break;
+                case OutputKind::POSTER_FRAME:
+                    args.insert(args.end(), {"-map", labels[i], "-frames:v", "1", "-update", "1"});
+                    break;
+                case OutputKind::PROXY:
+                    args.insert(args.end(), {"-map", labels[i], "-map", "0:a:0?", "-c:v", "libx264", "-preset",
+                                             "veryfast", "-crf", "28", "-c:a", "aac", "-b:a", "96k"});
+                    break;
+            }
+            args.insert(args.end(), spec.extraArgs.begin(), spec.extraArgs.end());
+            args.push_back(spec.path);
+        }
+        return args;
+    }
+
+    /**
+     * 用给定的执行器运行任务并汇报各路输出的结果（会占用执行器的行回调）
+     * @param executor 执行器
+     * @param on_line 额外的每行输出回调
+     * @return 任务结果
+     */
+    MultiOutputResult run(FFmpegExecutor& executor, FFmpegExecutor::LineCallback on_line = nullptr) const {
+        MultiOutputResult result;
+        result.outputs.resize(outputs_.size());
+        if (outputs_.empty()) {
+            result.execution = FFmpegExecutor::makeEmptyResult();
+            result.execution.error = "没有指定任何输出";
+            return result;
+        }
+
+        executor.setLineCallback([&](std::string_view line) {
+            if (on_line) {
+                on_line(line);
+            }
+            attributeError(line, result);
+        });
+        result.execution = executor.execute(buildArgs());
+        executor.setLineCallback(nullptr);
+        finish(result);
+        return result;
+    }
+
+    /**
+     * 把一行输出中的错误记到它所属的输出上；在执行器池中运行时由任务的行回调调用
+     * @param line 输出行
+     * @param result 任务结果，outputs须已按输出数分配
+     */
+    void attributeError(std::string_view line, MultiOutputResult& result) const {
+        if (!(OutputClassifier::instance().classify(line) & OutputClassifier::kError)) {
+            return;
+        }
+        int index = outputIndexOf(line);
+        if (index < 0 || static_cast<size_t>(index) >= result.outputs.size()) {
+            return;
+        }
+        std::string_view message;
+        OutputClassifier::parseLevel(line, message);
+        result.outputs[index].error.assign(message.data(), message.size());
+    }
+
+    /**
+     * 命令结束后按输出文件和归属的错误汇总各路输出的结果
+     * @param result 已填好execution的任务结果
+     */
+    void finish(MultiOutputResult& result) const {
+        result.outputs.resize(outputs_.size());
+        result.success = true;
+        for (size_t i = 0; i < outputs_.size(); ++i) {
+            OutputStatus& status = result.outputs[i];
+            status.path = outputs_[i].path;
+            std::error_code ec;
+            auto size = std::filesystem::file_size(std::filesystem::u8path(status.path), ec);
+            status.bytes = ec ? -1 : static_cast<long long>(size);
+            if (status.error.empty() && !result.execution.success) {
+                status.error = result.execution.error;
+            }
+            status.success = result.execution.success && status.error.empty() && status.bytes > 0;
+            if (status.success) {
+                continue;
+            }
+            if (status.error.empty()) {
+                status.error = status.bytes < 0 ? "没有生成输出文件" : "输出文件为空";
+            }
+            result.success = false;
+        }
+    }
+
+    /**
+     * 从FFmpeg 6.0及以上版本的日志前缀中取出输出文件编号，
+     * 如 "[out#1/mp4 @ 0x...]"、"[vost#2:0/libx264 @ 0x...]"、"[aost#0:1/aac @ 0x...]"
+     * @param line 输出行
+     * @return 输出文件编号，不属于某个输出时为-1
+     */
+    static int outputIndexOf(std::string_view line) {
+        static constexpr std::string_view kPrefixes[] = {"[out#", "[vost#", "[aost#", "[sost#", "[dost#", "[vf#", "[af#"};
+        for (std::string_view prefix : kPrefixes) {
+            if (line.compare(0, prefix.size(), prefix) != 0) {
+                continue;
+            }
+            int index = -1;
+            auto res = std::from_chars(line.data() + prefix.size(), line.data() + line.size(), index);
+            return res.ec == std::errc() ? index : -1;
+        }
+        return -1;
+    }
+
+private:
+    std::string input_;
+    std::string ffmpeg_;
+    std::vector<OutputSpec> outputs_;
+
+    /**
+     * 把秒数格式化为滤镜参数，去掉多余的0
+     */
+    static std::string formatSeconds(double seconds) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.3f", seconds);
+        std::string value = text;
+        while (value.back() == '0') {
+            value.pop_back();
+        }
+        if (value.back() == '.') {
+            value.pop_back();
+        }
+        return value;
+    }
+};
+
+/**
+ * 分段并行编码：单个FFmpeg进程的编码器在线程数增加到一定程度后不再变快，长视频按关键帧切成若干段，
+ * 每段作为独立任务提交到执行器池并行编码，音轨单独作为一个任务整体编码（避免每段开头的编码器延迟
+ * 在拼接处造成杂音），最后用 concat 分离器把各段和音轨不重新编码地合成输出文件，并核对时长和帧数。
+ * 目前只作为库提供，菜单中的转换不使用它
+ *
+ * 用法：
+ *     ExecutorPool pool(0, true);
+ *     SegmentedEncodeJob job("in.mkv", "out.mp4");
+ *     job.setVideoArgs({"-c:v", "libx264", "-preset", "medium", "-crf", "20"});
+ *     SegmentedEncodeJob::SegmentedResult result = job.run(pool);
+ */
+class SegmentedEncodeJob {
+public:
+    /**
+     * 一个片段：[startSeconds, endSeconds) 内的帧，起点是关键帧
+     */
+    struct Segment {
+        double startSeconds = 0;
+        double endSeconds = 0;
+        long long frames = 0;                   // 片段内的视频帧数
+        std::string path;                       // 片段文件
+        bool success = false;
+        double wallSeconds = -1;                // 编码用时
+        std::string error;
+    };
+
+    /**
+     * 任务的结果
+     */
+    struct SegmentedResult {
+        bool success = false;
+        std::string error;
+        std::vector<Segment> segments;
+        double sourceDurationSeconds = -1;
+        double outputDurationSeconds = -1;
+        long long sourceFrames = -1;
+        long long outputFrames = -1;
+        double wallSeconds = -1;                // 从探测到拼接完成的总用时
+        double encodeSeconds = -1;              // 各片段编码用时之和，与wallSeconds之比即并行加速比
+        FFmpegExecutor::ExecuteResult concat;   // 拼接命令的执行结果
+    };
+
+    /**
+     * 构造函数
+     * @param input 输入文件路径
+     * @param output 输出文件路径
+     * @param ffmpeg FFmpeg可执行文件路径
+     * @param ffprobe ffprobe可执行文件路径，空表示与FFmpeg同目录
+     */
+    SegmentedEncodeJob(std::string input, std::string output, std::string ffmpeg = "ffmpeg", std::string ffprobe = "")
+        : input_(std::move(input)), output_(std::move(output)), ffmpeg_(std::move(ffmpeg)),
+          ffprobe_(ffprobe.empty() ? MediaProbe::siblingOf(ffmpeg_) : std::move(ffprobe)) {}
+
+    /**
+     * 设置视频编码参数，每个片段都使用
+     * @param args 如 {"-c:v", "libx264", "-preset", "medium", "-crf", "20"}
+     */
+    void setVideoArgs(std::vector<std::string> args) {
+        video_args_ = std::move(args);
+    }
+
+    /**
+     * 设置音频编码参数，所有音轨作为一个任务整体编码
+     * @param args 如 {"-c:a", "aac", "-b:a", "192k"}，{"-c:a", "copy"} 表示不重新编码
+     */
+    void setAudioArgs(std::vector<std::string> args) {
+        audio_args_ = std::move(args);
+    }
+
+    /**
+     * 设置片段的目标时长，实际片段在此之后的第一个关键帧处切分
+     * @param seconds 目标时长（秒），0表示按池的工作线程数自动选择（每个线程约3段，10到300秒之间）
+     */
+    void setSegmentSeconds(double seconds) {
+        segment_seconds_ = seconds;
+    }
+
+    /**
+     * 设置存放片段的临时目录
+     * @param dir 目录，空表示输出文件旁的 <输出文件名>.segments
+     */
+    void setWorkDir(std::string dir) {
+        work_dir_ = std::move(dir);
+    }
+
+    /**
+     * 设置成功后是否保留片段文件（失败时总是保留，便于排查）
+     * @param keep 是否保留
+     */
+    void setKeepSegments(bool keep) {
+        keep_segments_ = keep;
+    }
+
+    /**
+     * 设置是否覆盖已存在的输出文件
+     * @param overwrite 是否覆盖
+     */
+    void setOverwrite(bool overwrite) {
+        overwrite_ = overwrite;
+    }
+
+    /**
+     * 按关键帧把视频切分为片段
+     * @param packets 按时间排序的视频数据包（MediaProbe::videoPackets的结果）
+     * @param segment_seconds 片段的目标时长
+     * @return 片段列表，覆盖全部数据包；没有关键帧时为空
+     */
+    static std::vector<Segment> planSegments(const std::vector<MediaProbe::PacketInfo>& packets,
+                                             double segment_seconds) {
+        std::vector<Segment> segments;
+        for (const MediaProbe::PacketInfo& packet : packets) {
+            bool cut = packet.keyframe &&
+                       (segments.empty() || packet.time >= segments.back().startSeconds + segment_seconds);
+            if (cut) {
+                if (!segments.empty()) {
+                    segments.back().endSeconds = packet.time;
+                }
+                segments.emplace_back();
+                segments.back().startSeconds = packet.time;
+            }
+            // 第一个关键帧之前的包（开放GOP的前导帧）解码不出来，不计入
+            if (!segments.empty()) {
+                segments.back().frames++;
+                segments.back().endSeconds = std::max(segments.back().endSeconds, packet.time);
+            }
+        }
+        return segments;
+    }
+
+    /**
+     * 探测、分段、并行编码、拼接并校验
+     * @param pool 执行器池，片段和音轨任务都提交到这里，并行度由池决定
+     * @return 任务结果
+     */
+    SegmentedResult run(ExecutorPool& pool) {
+        SegmentedResult result;
+        auto start = std::chrono::steady_clock::now();
+        MediaProbe probe(ffprobe_);
+        MediaProbe::MediaInfo info;
+        std::vector<MediaProbe::PacketInfo> packets;
+        if (!probe.probe(input_, info) || !probe.videoPackets(input_, info.startSeconds, packets)) {
+            result.error = "探测输入失败: " + probe.getLastError();
+            return result;
+        }
+        result.sourceDurationSeconds = info.durationSeconds;
+
+        double segment_seconds = segment_seconds_;
+        if (segment_seconds <= 0) {
+            double duration = info.durationSeconds > 0 ? info.durationSeconds : packets.back().time;
+            segment_seconds = std::min(300.0, std::max(10.0, duration / (pool.workerCount() * 3.0)));
+        }
+        result.segments = planSegments(packets, segment_seconds);
+        if (result.segments.empty()) {
+            result.error = "输入中没有关键帧";
+            return result;
+        }
+        result.sourceFrames = 0;
+        for (const Segment& segment : result.segments) {
+            result.sourceFrames += segment.frames;
+        }
+
+        std::string work_dir = work_dir_.empty() ? output_ + ".segments" : work_dir_;
+        std::filesystem::path work_path = std::filesystem::u8path(work_dir);
+        std::error_code ec;
+        std::filesystem::create_directories(work_path, ec);
+        if (ec) {
+            result.error = "无法创建临时目录 " + work_dir + ": " + ec.message();
+            return result;
+        }
+
+        // 片段用NUT封装：时间基与源一致，拼接时不会因毫秒取整累积误差
+        std::vector<FFmpegExecutor::AsyncHandle> handles;
+        for (size_t i = 0; i < result.segments.size(); ++i) {
+            Segment& segment = result.segments[i];
+            char name[32];
+            std::snprintf(name, sizeof(name), "seg_%05zu.nut", i);
+            segment.path = (work_path / name).u8string();
+            ExecutorPool::Job job;
+            job.argv = {ffmpeg_, "-y", "-ss", formatSeconds(segment.startSeconds), "-i", input_, "-map", "0:v:0",
+                        "-an", "-sn", "-dn", "-frames:v", std::to_string(segment.frames)};
+            job.argv.insert(job.argv.end(), video_args_.begin(), video_args_.end());
+            job.argv.push_back(segment.path);
+            handles.push_back(pool.submit(std::move(job)));
+        }
+        std::string audio_path;
+        FFmpegExecutor::AsyncHandle audio_handle;
+        if (info.count("audio") > 0) {
+            audio_path = (work_path / "audio.mka").u8string();
+            ExecutorPool::Job job;
+            job.argv = {ffmpeg_, "-y", "-i", input_, "-map", "0:a", "-vn", "-sn", "-dn"};
+            job.argv.insert(job.argv.end(), audio_args_.begin(), audio_args_.end());
+            job.argv.push_back(audio_path);
+            audio_handle = pool.submit(std::move(job));
+        }
+
+        // 任一片段失败就取消其余尚未完成的任务；被取消的任务也要等到结束，返回后不能还有进程在写临时目录
+        int failed = -1;
+        result.encodeSeconds = 0;
+        for (size_t i = 0; i < handles.size(); ++i) {
+            FFmpegExecutor::ExecuteResult encoded = handles[i].get();
+            Segment& segment = result.segments[i];
+            segment.success = encoded.success;
+            segment.wallSeconds = encoded.usage.wallSeconds;
+            segment.error = encoded.error;
+            result.encodeSeconds += std::max(0.0, encoded.usage.wallSeconds);
+            if (!encoded.success && failed == -1) {
+                failed = static_cast<int>(i);
+                for (size_t j = i + 1; j < handles.size(); ++j) {
+                    handles[j].cancel();
+                }
+                if (audio_handle.valid()) {
+                    audio_handle.cancel();
+                }
+            }
+        }
+        FFmpegExecutor::ExecuteResult audio;
+        if (audio_handle.valid()) {
+            audio = audio_handle.get();
+            result.encodeSeconds += std::max(0.0, audio.usage.wallSeconds);
+        }
+        if (failed != -1) {
+            const Segment& segment = result.segments[failed];
+            result.error = "片段" + std::to_string(failed) + "编码失败: " +
+                           (segment.error.empty() ? "未知错误" : segment.error);
+            return result;
+        }
+        if (audio_handle.valid() && !audio.success) {
+            result.error = "音轨编码失败: " + (audio.error.empty() ? "未知错误" : audio.error);
+            return result;
+        }
+
+        std::string list_path = (work_path / "segments.txt").u8string();
+        {
+            std::ofstream list(work_path / "segments.txt", std::ios::binary | std::ios::trunc);
+            for (const Segment& segment : result.segments) {
+                list << "file '" << escapeConcatPath(std::filesystem::u8path(segment.path).filename().u8string()) << "'\n";
+            }
+            if (!list) {
+                result.error = "无法写入片段列表 " + list_path;
+                return result;
+            }
+        }
+        std::vector<std::string> concat_args = {ffmpeg_, "-f", "concat", "-safe", "0", "-i", list_path};
+        if (!audio_path.empty()) {
+            concat_args.insert(concat_args.end(), {"-i", audio_path});
+        }
+        concat_args.insert(concat_args.end(), {"-map", "0:v"});
+        if (!audio_path.empty()) {
+            concat_args.insert(concat_args.end(), {"-map", "1:a"});
+        }
+        concat_args.insert(concat_args.end(), {"-c", "copy", output_});
+        FFmpegExecutor executor;
+        executor.setAutoOverwrite(overwrite_);
+        result.concat = executor.execute(concat_args);
+        if (!result.concat.success) {
+            result.error = "拼接失败: " + (result.concat.error.empty() ? "退出码 " + std::to_string(result.concat.exitCode)
+                                                                       : result.concat.error);
+            return result;
+        }
+
+        // 校验：帧数必须与源一致，时长允许容器和音轨带来的少量差异
+        MediaProbe::MediaInfo output_info;
+        if (probe.probe(output_, output_info)) {
+            result.outputDurationSeconds = output_info.durationSeconds;
+        }
+        result.outputFrames = probe.countVideoFrames(output_);
+        result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (result.outputFrames != result.sourceFrames) {
+            result.error = "输出帧数 " + std::to_string(result.outputFrames) + " 与源帧数 " +
+                           std::to_string(result.sourceFrames) + " 不一致";
+            return result;
+        }
+        if (result.sourceDurationSeconds > 0 &&
+            std::fabs(result.outputDurationSeconds - result.sourceDurationSeconds) > kDurationToleranceSeconds) {
+            result.error = "输出时长 " + formatSeconds(result.outputDurationSeconds) + " 秒与源时长 " +
+                           formatSeconds(result.sourceDurationSeconds) + " 秒相差过大";
+            return result;
+        }
+        result.success = true;
+        if (!keep_segments_) {
+            std::filesystem::remove_all(work_path, ec);
+        }
+        return result;
+    }
+
+private:
+    // 输出与源的时长允许相差的秒数
+    static constexpr double kDurationToleranceSeconds = 0.5;
+
+    std::string input_;
+    std::string output_;
+    std::string ffmpeg_;
+    std::string ffprobe_;
+    std::vector<std::string> video_args_ = {"-c:v", "libx264"};
+    std::vector<std::string> audio_args_ = {"-c:a", "aac", "-b:a", "192k"};
+    double segment_seconds_ = 0;
+    std::string work_dir_;
+    bool keep_segments_ = false;
+    bool overwrite_ = true;
+
+    /**
+     * 把秒数格式化为参数，保留微秒精度
+     */
+    static std::string formatSeconds(double seconds) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.6f", seconds);
+        return text;
+    }
+
+    /**
+     * 转义 concat 列表中单引号内的路径
+     */
+    static std::string escapeConcatPath(const std::string& path) {
+        std::string escaped;
+        for (char c : path) {
+            if (c == '\'') {
+                escaped += "'\\''";
+            } else {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+};
+
+/**
+ * 格式转换：先用ffprobe读出各路流的编码，再按输出容器的兼容表逐路决定复制还是重新编码。
+ * 所有流都能放进目标容器时整体流复制（只重新封装，速度取决于磁盘），部分能放进时只复制这些流，
+ * 都不能时与 ffmpeg -i in out 相同，由容器的默认编码器重新编码。复制失败时自动改为重新编码重试一次
+ *
+ * 用法：
+ *     ConvertJob job("in.mkv", "out.mp4");
+ *     ConvertJob::ConvertResult result = job.run(executor);
+ *     // result.plan.strategy 为 REMUX / PARTIAL_COPY / TRANSCODE
+ *     // 多个文件：ConvertJob::runAll(jobs, plans, pool, options) 在执行器池中并行，复制失败时同样重试
+ */
+class ConvertJob {
+public:
+    /**
+     * 转换方式
+     */
+    enum class Strategy {
+        REMUX,          // 所有流都复制
+        PARTIAL_COPY,   // 部分流复制，其余重新编码
+        TRANSCODE       // 全部重新编码
+    };
+
+    /**
+     * 一路流的处理方式
+     */
+    struct StreamDecision {
+        int index = -1;             // 输入中的流编号
+        std::string type;           // video、audio、subtitle
+        std::string codec;          // 输入的编码
+        bool copy = false;          // 是否复制，否则由容器的默认编码器重新编码
+    };
+
+    /**
+     * 转换计划
+     */
+    struct ConvertPlan {
+        Strategy strategy = Strategy::TRANSCODE;
+        std::vector<StreamDecision> streams;    // 输出的各路流，顺序即输出中的顺序；无法探测时为空
+        std::vector<std::string> args;          // 完整的FFmpeg参数数组
+        std::string note;                       // 选择该方式的原因，如探测失败、有流被舍弃
+    };
+
+    /**
+     * 转换结果
+     */
+    struct ConvertResult {
+        ConvertPlan plan;                       // 实际执行的计划
+        bool retriedWithTranscode = false;      // 是否因复制失败改为重新编码
+        FFmpegExecutor::ExecuteResult execution;
+        double wallSeconds = 0;                 // 总用时，含复制失败的那一次
+        FFmpegExecutor::ProgressEvent progress; // 最后一次进度快照（runAll填写）
+    };
+
+    // 每个任务完成时的回调，index为任务在列表中的位置
+    using DoneCallback = std::function<void(size_t index, const ConvertResult& result)>;
+
+    /**
+     * 构造函数
+     * @param input 输入文件路径
+     * @param output 输出文件路径，按扩展名确定容器
+     * @param ffmpeg FFmpeg可执行文件路径
+     * @param ffprobe ffprobe可执行文件路径，空表示与FFmpeg同目录
+     */
+    ConvertJob(std::string input, std::string output, std::string ffmpeg = "ffmpeg", std::string ffprobe = "")
+        : input_(std::move(input)), output_(std::move(output)), ffmpeg_(std::move(ffmpeg)),
+          ffprobe_(ffprobe.empty() ? MediaProbe::siblingOf(ffmpeg_) : std::move(ffprobe)) {}
+
+    /**
+     * 转换方式的名称
+     * @param strategy 转换方式
+     * @return 名称
+     */
+    static const char* strategyName(Strategy strategy) {
+        switch (strategy) {
+            case Strategy::REMUX:
+                return "remux";
+            case Strategy::PARTIAL_COPY:
+                return "partial-copy";
+            case Strategy::TRANSCODE:
+                return "transcode";
+        }
+        return "";
+    }
+
+    /**
+     * 查询兼容表：某种编码能否不经重新编码放进某种容器
+     * @param extension 输出文件扩展名（不含点，不区分大小写）
+     * @param type 流类型：video、audio、subtitle
+     * @param codec ffprobe报告的编码名
+     * @return 是否可以复制；表中没有的容器一律返回false
+     */
+    static bool containerAccepts(const std::string& extension, const std::string& type, const std::string& codec) {
+        const ContainerCodecs* container = findContainer(extension);
+        if (!container || codec.empty()) {
+            return false;
+        }
+        const char* list = type == "video" ? container->video : type == "audio" ? container->audio
+                         : type == "subtitle" ? container->subtitle : "";
+        return listContains(list, codec);
+    }
+
+    /**
+     * 兼容表中空格分隔的编码列表是否含有某一项，"*" 匹配任意非空项
+     * @param list 编码列表
+     * @param item 编码名或扩展名
+     * @return 是否含有
+     */
+    static bool listContains(std::string_view list, std::string_view item) {
+        if (list == "*") {
+            return !item.empty();
+        }
+        while (!list.empty()) {
+            size_t space = list.find(' ');
+            if (list.substr(0, space) == item) {
+                return true;
+            }
+            list = space == std::string_view::npos ? std::string_view() : list.substr(space + 1);
+        }
+        return false;
+    }
+
+    /**
+     * 保证同一批任务的输出路径互不相同：与本批已用的路径重名时在扩展名前加 _1、_2 ...
+     * 如 a.mkv 和 a.avi 都转换为 mp4 时，第二个输出为 a_1.mp4。比较时不区分大小写和路径分隔符（Windows的规则）
+     * @param path 按命名规则生成的输出路径
+     * @param used 本批已用的路径，返回的路径会加入其中
+     * @return 不重名的输出路径
+     */
+    static std::string uniqueOutputPath(const std::string& path, std::set<std::string>& used) {
+        auto key_of = [](std::string key) {
+            for (char& c : key) {
+                c = c == '/' ? '\\' : static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            }
+            return key;
+        };
+        size_t name_start = path.find_last_of("/\\");
+        name_start = name_start == std::string::npos ? 0 : name_start + 1;
+        size_t dot = path.find_last_of('.');
+        if (dot == std::string::npos || dot <= name_start) {
+            dot = path.size();
+        }
+        std::string output = path;
+        for (int suffix = 1; !used.insert(key_of(output)).second; ++suffix) {
+            output = path.substr(0, dot) + "_" + std::to_string(suffix) + path.substr(dot);
+        }
+        return output;
+    }
+
+    /**
+     * 按探测结果制定转换计划
+     * @param info 输入的媒体信息
+     * @return 转换计划
+     */
+    ConvertPlan plan(const MediaProbe::MediaInfo& info) const {
+        ConvertPlan plan;
+        std::string extension = extensionOf(output_);
+        const ContainerCodecs* container = findContainer(extension);
+        if (!container) {
+            plan.args = transcodeArgs();
+            plan.note = "兼容表中没有 ." + extension + " 容器";
+            return plan;
+        }
+
+        // 与FFmpeg默认选择相近：第一路视频（不含封面图）、全部音轨、能放进容器的字幕
+        bool has_video = false;
+        size_t dropped = 0;
+        for (const MediaProbe::StreamInfo& stream : info.streams) {
+            StreamDecision decision;
+            decision.index = stream.index;
+            decision.type = stream.type;
+            decision.codec = stream.codec;
+            decision.copy = containerAccepts(extension, stream.type, stream.codec);
+            if (stream.type == "video") {
+                if (has_video || stream.attachedPicture) {
+                    continue;
+                }
+                has_video = true;
+            } else if (stream.type == "subtitle") {
+                // 字幕只在文本之间或图像之间转换，目标容器没有对应的文本字幕编码时舍弃
+                bool convertible = container->textSubtitle[0] != '\0' && listContains(kTextSubtitles, stream.codec);
+                if (!decision.copy && !convertible) {
+                    dropped++;
+                    continue;
+                }
+            } else if (stream.type != "audio") {
+                continue;
+            }
+            plan.streams.push_back(decision);
+        }
+        if (plan.streams.empty()) {
+            plan.args = transcodeArgs();
+            plan.note = "输入中没有可转换的视频或音频流";
+            return plan;
+        }
+
+        size_t copied = std::count_if(plan.streams.begin(), plan.streams.end(),
+                                      [](const StreamDecision& d) { return d.copy; });
+        if (copied == 0) {
+            plan.args = transcodeArgs();
+            return plan;
+        }
+        plan.strategy = copied == plan.streams.size() ? Strategy::REMUX : Strategy::PARTIAL_COPY;
+        plan.args = {ffmpeg_, "-i", input_};
+        for (const StreamDecision& decision : plan.streams) {
+            plan.args.insert(plan.args.end(), {"-map", "0:" + std::to_string(decision.index)});
+        }
+        for (size_t i = 0; i < plan.streams.size(); ++i) {
+            if (plan.streams[i].copy) {
+                plan.args.insert(plan.args.end(), {"-c:" + std::to_string(i), "copy"});
+            } else if (plan.streams[i].type == "subtitle") {
+                plan.args.insert(plan.args.end(), {"-c:" + std::to_string(i), container->textSubtitle});
+            }
+        }
+        plan.args.push_back(output_);
+        if (dropped > 0) {
+            plan.note = std::to_string(dropped) + " 路字幕无法放进 ." + extension + " 容器，已舍弃";
+        }
+        return plan;
+    }
+
+    /**
+     * 探测输入并制定转换计划；探测失败时退回全部重新编码
+     * @return 转换计划
+     */
+    ConvertPlan plan() const {
+        MediaProbe probe(ffprobe_);
+        MediaProbe::MediaInfo info;
+        if (!probe.probe(input_, info)) {
+            ConvertPlan fallback;
+            fallback.args = transcodeArgs();
+            fallback.note = "探测输入失败，按重新编码处理: " + probe.getLastError();
+            return fallback;
+        }
+        return plan(info);
+    }
+
+    /**
+     * 全部重新编码的参数，即原来的 ffmpeg -i in out
+     * @return 参数数组
+     */
+    std::vector<std::string> transcodeArgs() const {
+        return {ffmpeg_, "-i", input_, output_};
+    }
+
+    /**
+     * 按计划执行；复制失败（如容器拒绝某个编码的特殊变体）时删除不完整的输出，改为全部重新编码重试一次。
+     * 拒绝覆盖、超时、被信号或stop()终止（退出码255或-1）时不重试
+     * @param executor 执行器
+     * @param plan 转换计划
+     * @return 转换结果
+     */
+    ConvertResult run(FFmpegExecutor& executor, const ConvertPlan& plan) const {
+        ConvertResult result;
+        result.plan = plan;
+        result.execution = executor.execute(plan.args);
+        result.wallSeconds = std::max(0.0, result.execution.usage.wallSeconds);
+        if (!shouldRetry(result)) {
+            return result;
+        }
+        switchToTranscode(result);
+        result.execution = executor.execute(result.plan.args);
+        result.wallSeconds += std::max(0.0, result.execution.usage.wallSeconds);
+        return result;
+    }
+
+    /**
+     * 在执行器池中并行运行一组转换；与run()一样，复制失败的任务删除不完整的输出，改为重新编码再提交一次
+     * @param jobs 任务
+     * @param plans 各任务的转换计划，顺序与jobs一致
+     * @param pool 执行器池
+     * @param options 其余的任务选项（覆盖、输出保留、cgroup等），其中的argv被忽略
+     * @param on_done 每个任务最终完成时的回调（在调用线程中按jobs的顺序触发）
+     * @return 各任务的结果，顺序与jobs一致
+     */
+    static std::vector<ConvertResult> runAll(const std::vector<ConvertJob>& jobs, const std::vector<ConvertPlan>& plans,
+                                             ExecutorPool& pool, const ExecutorPool::Job& options,
+                                             DoneCallback on_done = nullptr) {
+        std::vector<ConvertResult> results(jobs.size());
+        std::vector<FFmpegExecutor::AsyncHandle> handles(jobs.size());
+        auto submit = [&](size_t i) {
+            ExecutorPool::Job job = options;
+            job.argv = results[i].plan.args;
+            handles[i] = pool.submit(std::move(job));
+        };
+        auto collect = [&](size_t i) {
+            results[i].execution = handles[i].get();
+            results[i].progress = handles[i].progress();
+            results[i].wallSeconds += std::max(0.0, results[i].execution.usage.wallSeconds);
+        };
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            results[i].plan = plans[i];
+            submit(i);
+        }
+
+        // 第一遍结束后立即提交重新编码，不等其他任务
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            collect(i);
+            if (jobs[i].shouldRetry(results[i])) {
+                jobs[i].switchToTranscode(results[i]);
+                submit(i);
+                continue;
+            }
+            if (on_done) {
+                on_done(i, results[i]);
+            }
+        }
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            if (!results[i].retriedWithTranscode) {
+                continue;
+            }
+            collect(i);
+            if (on_done) {
+                on_done(i, results[i]);
+            }
+        }
+        return results;
+    }
+
+    /**
+     * 探测、制定计划并执行
+     * @param executor 执行器
+     * @return 转换结果
+     */
+    ConvertResult run(FFmpegExecutor& executor) const {
+        return run(executor, plan());
+    }
+
+private:
+    /**
+     * 一种容器可直接放入的编码，空格分隔，"*" 表示任意
+     */
+    struct ContainerCodecs {
+        const char* extensions;
+        const char* video;
+        const char* audio;
+        const char* subtitle;
+        const char* textSubtitle;   // 文本字幕转换的目标编码，空表示不支持
+    };
+
+    // 文本字幕编码
+    static constexpr const char* kTextSubtitles = "subrip srt ass ssa webvtt mov_text text";
+
+    static const ContainerCodecs* findContainer(const std::string& extension) {
+        static const ContainerCodecs kContainers[] = {
+            {"mp4 m4v mov", "h264 hevc mpeg4 av1 vp9 mjpeg", "aac mp3 ac3 eac3 alac opus", "mov_text", "mov_text"},
+            {"mkv", "*", "*", "subrip ass ssa webvtt hdmv_pgs_subtitle dvd_subtitle dvb_subtitle", "subrip"},
+            {"webm", "vp8 vp9 av1", "vorbis opus", "webvtt", "webvtt"},
+            {"ts m2ts mts", "h264 hevc mpeg2video mpeg1video", "aac mp3 mp2 ac3 eac3", "dvb_subtitle", ""},
+            {"avi", "mpeg4 h264 mjpeg msmpeg4v3", "mp3 ac3 pcm_s16le", "", ""},
+            {"flv", "h264", "aac mp3", "", ""},
+        };
+        std::string lower = extension;
+        std::transform(lower.begin(), lower.end(), lower.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        for (const ContainerCodecs& container : kContainers) {
+            if (listContains(container.extensions, lower)) {
+                return &container;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * 第一次执行失败后是否改为重新编码重试：只对有流复制的计划，且不是拒绝覆盖、超时、
+     * 被信号或stop()终止（退出码255或-1）的失败
+     */
+    static bool shouldRetry(const ConvertResult& result) {
+        const FFmpegExecutor::ExecuteResult& first = result.execution;
+        return !first.success && !result.retriedWithTranscode && result.plan.strategy != Strategy::TRANSCODE &&
+               !first.timedOut && !first.stalled && first.exitCode != 255 && first.exitCode >= 0 &&
+               !(first.overwritePrompted && !first.overwriteConfirmed);
+    }
+
+    /**
+     * 删除复制失败留下的不完整输出，把结果中的计划换成全部重新编码
+     */
+    void switchToTranscode(ConvertResult& result) const {
+        const FFmpegExecutor::ExecuteResult& first = result.execution;
+        std::error_code ec;
+        std::filesystem::remove(std::filesystem::u8path(output_), ec);
+        result.retriedWithTranscode = true;
+        result.plan.strategy = Strategy::TRANSCODE;
+        result.plan.args = transcodeArgs();
+        result.plan.note = "流复制失败，已改为重新编码: " +
+                           (first.error.empty() ? "退出码 " + std::to_string(first.exitCode) : first.error);
+    }
+
+    /**
+     * 文件扩展名（不含点）
+     */
+    static std::string extensionOf(const std::string& path) {
+        size_t name_start = path.find_last_of("/\\");
+        size_t dot = path.find_last_of('.');
+        if (dot == std::string::npos || (name_start != std::string::npos && dot < name_start)) {
+            return "";
+        }
+        return path.substr(dot + 1);
+    }
+
+    std::string input_;
+    std::string output_;
+    std::string ffmpeg_;
+    std::string ffprobe_;
+};
+
+/**
+ * 提取音频：一个输入的全部音轨在同一条FFmpeg命令中分别写出（只解封装一次），
+ * 编码能放进目标格式的音轨直接复制，否则由目标格式的默认编码器重新编码。
+ * 有音轨复制失败时整条命令会中止，失败的音轨重新编码、其余音轨照原方式再运行一次。
+ * 多个输入作为独立任务在执行器池中并行
+ *
+ * 用法：
+ *     std::vector<AudioExtractJob> jobs;
+ *     jobs.emplace_back("a.mkv", "out", "");        // 空格式：每条音轨按原编码选择容器
+ *     jobs.emplace_back("b.mp4", "out", "mp3");
+ *     for (auto& job : jobs) job.prepare();
+ *     ExecutorPool pool;
+ *     auto results = AudioExtractJob::runAll(jobs, pool, true);
+ */
+class AudioExtractJob {
+public:
+    /**
+     * 一条音轨的输出
+     */
+    struct TrackOutput {
+        int track = 0;                  // 第几路音频（从0开始）
+        std::string codec;              // 输入的编码
+        std::string language;           // 语言标签
+        std::string path;               // 输出文件路径
+        bool copy = false;              // 是否直接复制（最终采用的方式）
+        bool success = false;
+        long long bytes = -1;           // 输出文件大小
+        std::string error;
+    };
+
+    /**
+     * 一个输入的提取结果
+     */
+    struct AudioExtractResult {
+        std::string input;
+        bool success = false;                   // 所有音轨都成功
+        std::string error;                      // 探测失败、没有音轨等整体错误
+        bool retriedWithTranscode = false;      // 是否有音轨因复制失败而重新编码
+        std::vector<TrackOutput> tracks;
+        FFmpegExecutor::ExecuteResult execution;    // 一次写出全部音轨的那条命令的执行结果
+    };
+
+    // 每个输入完成时的回调，index为输入在列表中的位置
+    using DoneCallback = std::function<void(size_t index, const AudioExtractResult& result)>;
+
+    /**
+     * 构造函数
+     * @param input 输入文件路径
+     * @param output_dir 输出目录，空表示与输入相同的目录
+     * @param format 目标格式（扩展名，如 m4a、mp3、flac、wav），空表示每条音轨按原编码选择容器并复制
+     * @param ffmpeg FFmpeg可执行文件路径
+     * @param ffprobe ffprobe可执行文件路径，空表示与FFmpeg同目录
+     */
+    AudioExtractJob(std::string input, std::string output_dir = "", std::string format = "",
+                    std::string ffmpeg = "ffmpeg", std::string ffprobe = "")
+        : input_(std::move(input)), output_dir_(std::move(output_dir)), format_(std::move(format)),
+          ffmpeg_(std::move(ffmpeg)), ffprobe_(ffprobe.empty() ? MediaProbe::siblingOf(ffmpeg_) : std::move(ffprobe)) {
+        std::transform(format_.begin(), format_.end(), format_.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (!format_.empty() && format_[0] == '.') {
+            format_.erase(0, 1);
+        }
+    }
+
+    /**
+     * 某种音频编码可以直接复制进的容器
+     * @param codec ffprobe报告的编码名
+     * @return 扩展名；没有专门的容器时为 mka（Matroska可容纳任意编码）
+     */
+    static std::string containerFor(const std::string& codec) {
+        for (const AudioFormat& format : kFormats) {
+            if (std::string_view(format.codecs) != "*" && ConvertJob::listContains(format.codecs, codec)) {
+                return format.extension;
+            }
+        }
+        return "mka";
+    }
+
+    /**
+     * 某种编码能否不经重新编码写入某种格式
+     * @param extension 扩展名（小写，不含点）
+     * @param codec ffprobe报告的编码名
+     * @return 是否可以复制；不认识的格式一律返回false
+     */
+    static bool formatAccepts(const std::string& extension, const std::string& codec) {
+        for (const AudioFormat& format : kFormats) {
+            if (extension == format.extension) {
+                return ConvertJob::listContains(format.codecs, codec);
+            }
+        }
+        return false;
+    }
+
+    /**
+     * 探测输入并为每条音轨确定输出路径和方式
+     * @return 是否有可提取的音轨，失败原因见getError()
+     */
+    bool prepare() {
+        tracks_.clear();
+        MediaProbe probe(ffprobe_);
+        MediaProbe::MediaInfo info;
+        if (!probe.probe(input_, info)) {
+            error_ = "探测输入失败: " + probe.getLastError();
+            return false;
+        }
+        size_t audio_count = info.count("audio");
+        if (audio_count == 0) {
+            error_ = "输入中没有音轨";
+            return false;
+        }
+        // 路径在程序中是UTF-8，std::filesystem::path(std::string) 在Windows下会按ANSI代码页解释
+        std::filesystem::path source = std::filesystem::u8path(input_);
+        std::filesystem::path dir = output_dir_.empty() ? source.parent_path() : std::filesystem::u8path(output_dir_);
+        int track = 0;
+        for (const MediaProbe::StreamInfo& stream : info.streams) {
+            if (stream.type != "audio") {
+                continue;
+            }
+            TrackOutput output;
+            output.track = track++;
+            output.codec = stream.codec;
+            output.language = stream.language;
+            std::string extension = format_.empty() ? containerFor(stream.codec) : format_;
+            output.copy = formatAccepts(extension, stream.codec);
+            // 单条音轨：<名称>.<扩展名>；多条：<名称>.a<序号>[.<语言>].<扩展名>
+            std::string name = source.stem().u8string();
+            if (audio_count > 1) {
+                name += ".a" + std::to_string(output.track + 1);
+                if (!stream.language.empty() && stream.language != "und") {
+                    name += "." + stream.language;
+                }
+            }
+            output.path = (dir / std::filesystem::u8path(name + "." + extension)).u8string();
+            if (output.path == input_) {
+                output.path = (dir / std::filesystem::u8path(name + "_audio." + extension)).u8string();
+            }
+            tracks_.push_back(output);
+        }
+        error_.clear();
+        return true;
+    }
+
+    /**
+     * 与同一批其他输入的输出重名时（如 a.mkv 和 a.mp4 都得到 a.m4a），在后面的输出加上 _1、_2 ...
+     * 并行运行的命令会同时写重名的输出，应在prepare()之后、检查输出是否已存在之前对整批调用
+     * @param used 本批已用的输出路径，本任务的输出会加入其中
+     */
+    void makeOutputsUnique(std::set<std::string>& used) {
+        for (TrackOutput& track : tracks_) {
+            track.path = ConvertJob::uniqueOutputPath(track.path, used);
+        }
+    }
+
+    /**
+     * 获取prepare()确定的音轨输出
+     * @return 音轨输出
+     */
+    const std::vector<TrackOutput>& tracks() const {
+        return tracks_;
+    }
+
+    /**
+     * 获取prepare()的错误
+     * @return 错误信息
+     */
+    const std::string& getError() const {
+        return error_;
+    }
+
+    /**
+     * 获取输入文件路径
+     * @return 输入文件路径
+     */
+    const std::string& input() const {
+        return input_;
+    }
+
+    /**
+     * 运行一组已prepare()的任务：每个输入一条命令写出全部音轨，提交到执行器池并行执行；
+     * 输出按tracks()中的路径写出，不再改名，不同输入的输出重名时应先调用makeOutputsUnique()；
+     * 有音轨复制失败时删除不完整的输出再运行一次：错误归属于该音轨的（无法归属时为全部复制的音轨）改为重新编码
+     * @param jobs 任务
+     * @param pool 执行器池
+     * @param overwrite 是否覆盖已存在的输出文件
+     * @param on_done 每个输入完成时的回调（在调用线程中触发）
+     * @return 各输入的结果，顺序与jobs一致
+     */
+    static std::vector<AudioExtractResult> runAll(const std::vector<AudioExtractJob>& jobs, ExecutorPool& pool,
+                                                  bool overwrite, DoneCallback on_done = nullptr) {
+        std::vector<AudioExtractResult> results(jobs.size());
+        std::vector<std::shared_ptr<Pass>> passes(jobs.size());
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            results[i].input = jobs[i].input_;
+            results[i].tracks = jobs[i].tracks_;
+            if (jobs[i].tracks_.empty()) {
+                results[i].error = jobs[i].error_.empty() ? "尚未探测输入" : jobs[i].error_;
+                continue;
+            }
+            std::vector<size_t> all(jobs[i].tracks_.size());
+            std::iota(all.begin(), all.end(), 0);
+            passes[i] = jobs[i].submit(pool, all, std::vector<bool>(all.size(), false), overwrite);
+        }
+
+        // 第一遍结束后立即为复制失败的音轨提交重新编码，不等其他输入
+        std::vector<std::shared_ptr<Pass>> retries(jobs.size());
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            if (!passes[i]) {
+                if (on_done) {
+                    on_done(i, results[i]);
+                }
+                continue;
+            }
+            std::vector<size_t> attributed;
+            results[i].execution = collect(*passes[i], results[i], attributed);
+            std::vector<size_t> failed;
+            bool failed_copy = false;
+            for (size_t t : passes[i]->tracks) {
+                if (!results[i].tracks[t].success) {
+                    failed.push_back(t);
+                    failed_copy = failed_copy || results[i].tracks[t].copy;
+                }
+            }
+            bool interrupted = results[i].execution.timedOut || results[i].execution.stalled ||
+                               results[i].execution.exitCode == 255 || results[i].execution.exitCode < 0;
+            if (failed_copy && !interrupted) {
+                std::vector<bool> transcode;
+                for (size_t t : failed) {
+                    const TrackOutput& track = results[i].tracks[t];
+                    transcode.push_back(!track.copy || attributed.empty() ||
+                                        std::find(attributed.begin(), attributed.end(), t) != attributed.end());
+                    std::error_code ec;
+                    std::filesystem::remove(std::filesystem::u8path(track.path), ec);
+                }
+                results[i].retriedWithTranscode = true;
+                retries[i] = jobs[i].submit(pool, failed, transcode, overwrite);
+                continue;
+            }
+            summarize(results[i]);
+            if (on_done) {
+                on_done(i, results[i]);
+            }
+        }
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            if (!retries[i]) {
+                continue;
+            }
+            std::vector<size_t> attributed;
+            collect(*retries[i], results[i], attributed);
+            summarize(results[i]);
+            if (on_done) {
+                on_done(i, results[i]);
+            }
+        }
+        return results;
+    }
+
+private:
+    /**
+     * 一种音频格式可直接写入的编码，空格分隔，"*" 表示任意
+     * 按编码选择容器时取第一个含有该编码的格式，所以专用格式排在通用格式前面
+     */
+    struct AudioFormat {
+        const char* extension;
+        const char* codecs;
+    };
+
+    static constexpr AudioFormat kFormats[] = {
+        {"mp3", "mp3"},
+        {"flac", "flac"},
+        {"opus", "opus"},
+        {"ac3", "ac3"},
+        {"eac3", "eac3"},
+        {"dts", "dts"},
+        {"mp2", "mp2"},
+        {"wav", "pcm_s16le pcm_s24le pcm_s32le pcm_f32le pcm_u8"},
+        {"m4a", "aac alac ac3"},
+        {"aac", "aac"},
+        {"ogg", "vorbis opus flac"},
+        {"mka", "*"},
+    };
+
+    /**
+     * 提交到执行器池的一条命令：写出哪些音轨，以及运行中按输出归属的错误
+     */
+    struct Pass {
+        MultiOutputJob job;
+        MultiOutputJob::MultiOutputResult result;
+        std::vector<size_t> tracks;             // 第i个输出对应的音轨
+        std::vector<bool> copy;                 // 第i个输出是否直接复制
+        FFmpegExecutor::AsyncHandle handle;
+
+        Pass(const std::string& input, const std::string& ffmpeg) : job(input, ffmpeg) {}
+    };
+
+    std::string input_;
+    std::string output_dir_;
+    std::string format_;
+    std::string ffmpeg_;
+    std::string ffprobe_;
+    std::vector<TrackOutput> tracks_;
+    std::string error_;
+
+    /**
+     * 为指定的音轨建立一条命令并提交
+     * @param tracks 本条命令写出的音轨在tracks_中的下标
+     * @param transcode 各音轨是否强制重新编码（复制失败后的重试）
+     */
+    std::shared_ptr<Pass> submit(ExecutorPool& pool, const std::vector<size_t>& tracks,
+                                 const std::vector<bool>& transcode, bool overwrite) const {
+        auto pass = std::make_shared<Pass>(input_, ffmpeg_);
+        pass->tracks = tracks;
+        for (size_t i = 0; i < tracks.size(); ++i) {
+            const TrackOutput& output = tracks_[tracks[i]];
+            pass->copy.push_back(output.copy && !transcode[i]);
+            std::vector<std::string> codec_args;
+            if (pass->copy.back()) {
+                codec_args = {"-c:a", "copy"};
+            }
+            pass->job.addAudio(output.path, codec_args, output.track);
+        }
+        pass->result.outputs.resize(tracks.size());
+        ExecutorPool::Job job;
+        job.argv = pass->job.buildArgs();
+        job.autoOverwrite = overwrite;
+        // 行回调在工作线程中调用，结果在handle.get()之后才读取
+        job.onLine = [pass_ptr = pass.get()](std::string_view line) {
+            pass_ptr->job.attributeError(line, pass_ptr->result);
+        };
+        pass->handle = pool.submit(std::move(job));
+        return pass;
+    }
+
+    /**
+     * 等待一条命令结束，把各输出的结果写回对应的音轨
+     * @param attributed 日志中有错误明确归属的音轨
+     * @return 命令的执行结果
+     */
+    static FFmpegExecutor::ExecuteResult collect(Pass& pass, AudioExtractResult& result, std::vector<size_t>& attributed) {
+        pass.result.execution = pass.handle.get();
+        for (size_t i = 0; i < pass.tracks.size(); ++i) {
+            if (!pass.result.outputs[i].error.empty()) {
+                attributed.push_back(pass.tracks[i]);
+            }
+        }
+        pass.job.finish(pass.result);
+        for (size_t i = 0; i < pass.tracks.size(); ++i) {
+            TrackOutput& track = result.tracks[pass.tracks[i]];
+            const MultiOutputJob::OutputStatus& status = pass.result.outputs[i];
+            track.success = status.success;
+            track.bytes = status.bytes;
+            track.error = status.error;
+            track.copy = pass.copy[i];
+        }
+        return pass.result.execution;
+    }
+
+    /**
+     * 按各音轨的结果汇总整个输入的结果
+     */
+    static void summarize(AudioExtractResult& result) {
+        result.success = !result.tracks.empty();
+        for (const TrackOutput& track : result.tracks) {
+            if (!track.success) {
+                result.success = false;
+                if (result.error.empty()) {
+                    result.error = "音轨" + std::to_string(track.track + 1) + ": " + track.error;
+                }
+            }
+        }
+    }
+
+};
+
+#endif // FFMPEG_JOBS_H
@@ -1,5 +1,8 @@
 #include <iostream>
+#include <iomanip>
 #include <cstdio>
+#include <limits>
+#include <set>
 #include <string>
 #include <vector>
 #include <windows.h>
@@ -8,6 +11,9 @@
 #include "file_chooser.h"
 #include "SettingsManager.h"
 #include "ffmpeg_executor.h"
+#include "executor_pool.h"
+#include "ffmpeg_jobs.h"
+#include "concurrency_controller.h"
 using namespace std;
 
 void dividing_line(int length = 0)
@@ -72,6 +78,28 @@ bool FileExists(const std::string& filePath) {
            !(attributes & FILE_ATTRIBUTE_DIRECTORY));
 }
 
+/**
+ * @brief 获取文件大小
+ * @param filePath 文件路径（UTF-8编码）
+ * @return 文件字节数，文件不存在时返回-1
+ */
+long long FileSizeBytes(const std::string& filePath) {
+    int wideLen = MultiByteToWideChar(CP_UTF8, 0, filePath.c_str(), -1, nullptr, 0);
+    if (wideLen <= 0) return -1;
+    
+    wchar_t* widePath = new wchar_t[wideLen];
+    MultiByteToWideChar(CP_UTF8, 0, filePath.c_str(), -1, widePath, wideLen);
+    
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    BOOL found = GetFileAttributesExW(widePath, GetFileExInfoStandard, &data);
+    delete[] widePath;
+    
+    if (!found || (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        return -1;
+    }
+    return (static_cast<long long>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+}
+
 SettingsManager settings;
 
 template <typename... Args>
@@ -86,11 +114,460 @@ string buildCmd(const Args &...args)
     }
     return result;
 }
+/*
+ *@brief 从设置中读取每个ffmpeg任务的cgroup限制
+ *@return CgroupLimits cgroup.enabled为false时不建组
+ */
+CgroupLimits loadCgroupLimits()
+{
+    CgroupLimits limits;
+    limits.enabled = settings.getBool("cgroup.enabled");
+    limits.parent = settings.getString("cgroup.parent");
+    limits.moveSelf = settings.getBool("cgroup.move_self");
+    limits.cpuCores = settings.getDouble("cgroup.cpu_cores");
+    limits.memoryMax = settings.getString("cgroup.memory_max");
+    limits.memoryHigh = settings.getString("cgroup.memory_high");
+    limits.ioMax = settings.getString("cgroup.io_max");
+    return limits;
+}
+/*
+ *@brief batch.adaptive为true时为批量任务的执行器池启动并发控制器，按系统负载在1到池的工作线程数之间调整并发数
+ *@param pool 执行器池
+ *@return unique_ptr<ConcurrencyController> 控制器，未启用时为空；应在pool之后声明，先于pool析构
+ */
+unique_ptr<ConcurrencyController> startConcurrencyController(ExecutorPool &pool)
+{
+    if (!settings.getBool("batch.adaptive") || pool.workerCount() <= 1)
+    {
+        return nullptr;
+    }
+    auto controller = make_unique<ConcurrencyController>(pool);
+    controller->start();
+    return controller;
+}
 void about_this()
 {
     cout << "Convenient_CF ffmpeg tools v0.0.1 by Jane Smith" << endl;
     cout << "This tool provides various ffmpeg functionalities such as format conversion, audio extraction, and video merging." << endl;
 }
+/*
+ *@brief 按命名规则生成批量转换的输出路径：输出目录 + 输入文件名（不含扩展名）+ 新扩展名
+ *@param input 输入文件路径
+ *@param output_dir 输出目录，空表示与输入文件相同的目录
+ *@param extension 输出扩展名，不含点，如 mp4
+ *@return string 输出路径；与输入路径相同时在文件名后加 _converted
+ */
+string buildBatchOutputPath(const string &input, const string &output_dir, const string &extension)
+{
+    size_t name_start = input.find_last_of("/\\");
+    name_start = name_start == string::npos ? 0 : name_start + 1;
+    string name = input.substr(name_start);
+    size_t dot = name.find_last_of('.');
+    if (dot != string::npos && dot > 0)
+    {
+        name = name.substr(0, dot);
+    }
+    string dir = output_dir.empty() ? input.substr(0, name_start) : output_dir;
+    if (!dir.empty() && dir.back() != '/' && dir.back() != '\\')
+    {
+        dir += '\\';
+    }
+    string output = dir + name + "." + extension;
+    if (output == input)
+    {
+        output = dir + name + "_converted." + extension;
+    }
+    return output;
+}
+/*
+ *@brief 把字节数格式化为便于阅读的大小
+ *@param bytes 字节数，小于0表示文件不存在
+ *@return string 如 "12.3 MB"，文件不存在时为 "-"
+ */
+string formatFileSize(long long bytes)
+{
+    if (bytes < 0)
+    {
+        return "-";
+    }
+    const char *units[] = {"B", "KB", "MB", "GB", "TB"};
+    double size = static_cast<double>(bytes);
+    int unit = 0;
+    while (size >= 1024 && unit < 4)
+    {
+        size /= 1024;
+        unit++;
+    }
+    ostringstream oss;
+    oss << fixed << setprecision(unit == 0 ? 0 : 1) << size << " " << units[unit];
+    return oss.str();
+}
+/*
+ *@brief 批量视频格式转换：一次输入多个文件和输出命名规则，覆盖只询问一次，
+ *       任务在有上限的执行器池中并行运行，结束后逐个文件汇总用时、速度和大小
+ *@return int 0表示全部成功，非0表示有失败或被取消
+ */
+int Converting_video_batch()
+{
+    // 丢弃上一次 cin >> choice 留下的换行，否则第一次 getline 读到空行会直接结束输入
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    vector<string> input_files = multi_file_chooser("Please enter the video files to convert:");
+    vector<string> inputs;
+    for (const string &file : input_files)
+    {
+        if (filecheck::FileTypeChecker::checkFileType(file) != filecheck::FileType::VIDEO)
+        {
+            cout << "Skipped (not a valid video file): " << file << endl;
+            continue;
+        }
+        inputs.push_back(file);
+    }
+    if (inputs.empty())
+    {
+        cout << "No video files to convert." << endl;
+        return 1;
+    }
+
+    string output_dir = single_file_chooser("Please enter the output directory (enter . to use each input file's directory):");
+    if (output_dir.empty())
+    {
+        return 1;
+    }
+    if (output_dir == ".")
+    {
+        output_dir.clear();
+    }
+    cout << "Please enter the output format (file extension, e.g. mp4):" << endl;
+    string extension;
+    cin >> extension;
+    if (!extension.empty() && extension[0] == '.')
+    {
+        extension.erase(0, 1);
+    }
+    if (extension.empty())
+    {
+        cout << "Error: The output format is empty." << endl;
+        return 1;
+    }
+
+    // 同名不同扩展名的输入（如 a.mkv 和 a.avi）会得到相同的输出路径，并行写同一个文件，先加上序号区分
+    vector<string> outputs;
+    vector<size_t> existing;
+    set<string> used_outputs;
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        string output = buildBatchOutputPath(inputs[i], output_dir, extension);
+        outputs.push_back(ConvertJob::uniqueOutputPath(output, used_outputs));
+        if (outputs[i] != output)
+        {
+            cout << "Output renamed to avoid a name clash within the batch: " << outputs[i] << endl;
+        }
+        if (FileExists(outputs[i]))
+        {
+            existing.push_back(i);
+        }
+    }
+
+    // 覆盖只对整批询问一次，不覆盖时跳过这些文件
+    vector<bool> skipped(inputs.size(), false);
+    if (!existing.empty())
+    {
+        cout << existing.size() << " output file(s) already exist:" << endl;
+        for (size_t i : existing)
+        {
+            cout << "  " << outputs[i] << endl;
+        }
+        cout << "Overwrite all of them? [y/N] (N skips these files)" << endl;
+        char choice1 = 'N';
+        cin >> choice1;
+        if (choice1 != 'Y' && choice1 != 'y')
+        {
+            for (size_t i : existing)
+            {
+                skipped[i] = true;
+            }
+        }
+    }
+    size_t job_count = count(skipped.begin(), skipped.end(), false);
+    if (job_count == 0)
+    {
+        cout << "Nothing to convert." << endl;
+        return 0;
+    }
+
+    // batch.workers 为0时按CPU核数的一半，每个FFmpeg本身也是多线程的
+    size_t workers = settings.getInt("batch.workers") > 0 ? static_cast<size_t>(settings.getInt("batch.workers"))
+                                                          : max(1u, thread::hardware_concurrency() / 2);
+    workers = min(workers, job_count);
+    if (settings.getBool("isExecutionConfirmed"))
+    {
+        cout << "Converting " << job_count << " file(s) to ." << extension << " with " << workers
+             << " parallel job(s)." << endl
+             << "Y or n" << endl;
+        char choice2;
+        cin >> choice2;
+        if (choice2 != 'Y' && choice2 != 'y')
+        {
+            cout << "Operation cancelled by user." << endl;
+            return 0;
+        }
+    }
+
+    // 逐个探测输入，只换容器的文件直接流复制
+    string ffmpeg_path = settings.getString("ffmpeg.path");
+    vector<size_t> job_inputs;
+    vector<ConvertJob> jobs;
+    vector<ConvertJob::ConvertPlan> plans;
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        if (!skipped[i])
+        {
+            job_inputs.push_back(i);
+            jobs.emplace_back(inputs[i], outputs[i], ffmpeg_path);
+            plans.push_back(jobs.back().plan());
+        }
+    }
+
+    // 与单个文件转换一样，流复制失败的文件删除不完整的输出后改为重新编码再运行一次
+    ExecutorPool pool(workers);
+    unique_ptr<ConcurrencyController> controller = startConcurrencyController(pool);
+    ExecutorPool::Job options;
+    options.autoOverwrite = true;
+    options.captureOutput = settings.getBool("full_output");
+    options.cgroup = loadCgroupLimits();
+    vector<ConvertJob::ConvertResult> results(inputs.size());
+    size_t finished = 0;
+    auto batch_start = chrono::steady_clock::now();
+    vector<ConvertJob::ConvertResult> job_results = ConvertJob::runAll(
+        jobs, plans, pool, options, [&](size_t index, const ConvertJob::ConvertResult &result) {
+            finished++;
+            cout << "[" << finished << "/" << job_count << "] " << (result.execution.success ? "done  " : "FAILED") << " "
+                 << inputs[job_inputs[index]] << (result.retriedWithTranscode ? " (stream copy failed, re-encoded)" : "")
+                 << endl;
+        });
+    for (size_t j = 0; j < job_inputs.size(); j++)
+    {
+        results[job_inputs[j]] = move(job_results[j]);
+    }
+    double batch_seconds = chrono::duration<double>(chrono::steady_clock::now() - batch_start).count();
+
+    // 汇总：每个文件的用时、FFmpeg报告的速度（相对实时的倍速）、输入和输出大小
+    dividing_line(100);
+    cout << left << setw(40) << "file" << setw(9) << "status" << setw(14) << "strategy" << right << setw(10)
+         << "time(s)" << setw(9) << "speed" << setw(12) << "input" << setw(12) << "output" << endl;
+    double job_seconds = 0;
+    size_t failed = 0;
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        cout << left << setw(40) << outputs[i];
+        if (skipped[i])
+        {
+            cout << "skipped" << endl;
+            continue;
+        }
+        const FFmpegExecutor::ExecuteResult &result = results[i].execution;
+        const FFmpegExecutor::ProgressEvent &progress = results[i].progress;
+        double seconds = results[i].wallSeconds;
+        job_seconds += seconds;
+        failed += result.success ? 0 : 1;
+        ostringstream speed;
+        if (progress.speed > 0)
+        {
+            speed << fixed << setprecision(2) << progress.speed << "x";
+        }
+        else
+        {
+            speed << "-";
+        }
+        cout << setw(9) << (result.success ? "ok" : "failed") << setw(14) << ConvertJob::strategyName(results[i].plan.strategy)
+             << right << fixed << setprecision(1) << setw(10)
+             << seconds << setw(9) << speed.str() << setw(12) << formatFileSize(FileSizeBytes(inputs[i])) << setw(12)
+             << formatFileSize(FileSizeBytes(outputs[i])) << endl;
+        if (results[i].retriedWithTranscode)
+        {
+            cout << "    Note: " << results[i].plan.note << endl;
+        }
+        if (!result.success && !result.error.empty())
+        {
+            cout << "    Error: " << result.error << endl;
+        }
+        if (settings.getBool("full_output") && !result.success)
+        {
+            cout << result.output << endl;
+        }
+    }
+    dividing_line(100);
+    cout << fixed << setprecision(1) << job_count - failed << " succeeded, " << failed << " failed, "
+         << inputs.size() - job_count << " skipped. Batch time " << batch_seconds << "s, sum of job times "
+         << job_seconds << "s";
+    if (batch_seconds > 0)
+    {
+        cout << ", parallel speedup " << setprecision(2) << job_seconds / batch_seconds << "x";
+    }
+    cout << endl;
+    return failed == 0 ? 0 : 1;
+}
+/*
+ *@brief 从视频中提取音频：支持多个文件，每个文件的所有音轨一次写出，
+ *       能直接复制的音轨不重新编码，多个文件在执行器池中并行处理
+ *@return int 0表示全部成功，非0表示有失败或被取消
+ */
+int Extracting_audio()
+{
+    // 丢弃上一次 cin >> choice 留下的换行
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    vector<string> input_files = multi_file_chooser("Please enter the video files to extract audio from:");
+    if (input_files.empty())
+    {
+        return 1;
+    }
+    string output_dir = single_file_chooser("Please enter the output directory (enter . to use each input file's directory):");
+    if (output_dir.empty())
+    {
+        return 1;
+    }
+    if (output_dir == ".")
+    {
+        output_dir.clear();
+    }
+    cout << "Please enter the audio format (e.g. m4a, mp3, flac, wav), or auto to keep each track's original codec:"
+         << endl;
+    string format;
+    cin >> format;
+    if (format == "auto")
+    {
+        format.clear();
+    }
+
+    // 探测每个文件的音轨，确定每条音轨的输出和方式
+    string ffmpeg_path = settings.getString("ffmpeg.path");
+    vector<AudioExtractJob> jobs;
+    vector<string> existing;
+    // 同名不同扩展名的输入（如 a.mkv 和 a.mp4）会得到相同的音轨输出，先加上序号区分，再检查是否已存在
+    set<string> used_outputs;
+    for (const string &file : input_files)
+    {
+        if (filecheck::FileTypeChecker::checkFileType(file) != filecheck::FileType::VIDEO)
+        {
+            cout << "Skipped (not a valid video file): " << file << endl;
+            continue;
+        }
+        AudioExtractJob job(file, output_dir, format, ffmpeg_path);
+        if (!job.prepare())
+        {
+            cout << "Skipped " << file << ": " << job.getError() << endl;
+            continue;
+        }
+        job.makeOutputsUnique(used_outputs);
+        cout << file << ":" << endl;
+        for (const AudioExtractJob::TrackOutput &track : job.tracks())
+        {
+            cout << "  track " << track.track + 1 << " (" << track.codec
+                 << (track.language.empty() ? "" : ", " + track.language) << ") -> " << track.path
+                 << (track.copy ? "  [copy]" : "  [transcode]") << endl;
+            if (FileExists(track.path))
+            {
+                existing.push_back(track.path);
+            }
+        }
+        jobs.push_back(job);
+    }
+    if (jobs.empty())
+    {
+        cout << "No audio to extract." << endl;
+        return 1;
+    }
+
+    // 覆盖只对整批询问一次
+    bool overwrite = true;
+    if (!existing.empty())
+    {
+        cout << existing.size() << " output file(s) already exist. Overwrite all of them? [y/N]" << endl;
+        char choice1 = 'N';
+        cin >> choice1;
+        overwrite = choice1 == 'Y' || choice1 == 'y';
+        if (!overwrite)
+        {
+            // 不覆盖时跳过有输出已存在的文件，避免整条命令在覆盖提示处失败
+            vector<AudioExtractJob> kept;
+            for (const AudioExtractJob &job : jobs)
+            {
+                bool has_existing = false;
+                for (const AudioExtractJob::TrackOutput &track : job.tracks())
+                {
+                    has_existing = has_existing || FileExists(track.path);
+                }
+                if (has_existing)
+                {
+                    cout << "Skipped (output exists): " << job.input() << endl;
+                }
+                else
+                {
+                    kept.push_back(job);
+                }
+            }
+            jobs.swap(kept);
+            if (jobs.empty())
+            {
+                cout << "Nothing to extract." << endl;
+                return 0;
+            }
+        }
+    }
+
+    size_t workers = settings.getInt("batch.workers") > 0 ? static_cast<size_t>(settings.getInt("batch.workers"))
+                                                          : max(1u, thread::hardware_concurrency() / 2);
+    workers = min(workers, jobs.size());
+    if (settings.getBool("isExecutionConfirmed"))
+    {
+        cout << "Extracting audio from " << jobs.size() << " file(s) with " << workers << " parallel job(s)." << endl
+             << "Y or n" << endl;
+        char choice2;
+        cin >> choice2;
+        if (choice2 != 'Y' && choice2 != 'y')
+        {
+            cout << "Operation cancelled by user." << endl;
+            return 0;
+        }
+    }
+
+    ExecutorPool pool(workers);
+    unique_ptr<ConcurrencyController> controller = startConcurrencyController(pool);
+    size_t finished = 0;
+    auto batch_start = chrono::steady_clock::now();
+    vector<AudioExtractJob::AudioExtractResult> results = AudioExtractJob::runAll(
+        jobs, pool, overwrite, [&](size_t, const AudioExtractJob::AudioExtractResult &result) {
+            finished++;
+            cout << "[" << finished << "/" << jobs.size() << "] " << (result.success ? "done  " : "FAILED") << " "
+                 << result.input << endl;
+        });
+    double batch_seconds = chrono::duration<double>(chrono::steady_clock::now() - batch_start).count();
+
+    // 汇总：每条音轨的方式、结果和大小
+    dividing_line(100);
+    cout << left << setw(50) << "output" << setw(9) << "status" << setw(11) << "mode" << right << setw(12) << "size"
+         << endl;
+    size_t tracks_ok = 0, tracks_failed = 0, tracks_copied = 0;
+    for (const AudioExtractJob::AudioExtractResult &result : results)
+    {
+        for (const AudioExtractJob::TrackOutput &track : result.tracks)
+        {
+            cout << left << setw(50) << track.path << setw(9) << (track.success ? "ok" : "failed") << setw(11)
+                 << (track.copy ? "copy" : "transcode") << right << setw(12) << formatFileSize(track.bytes) << endl;
+            if (!track.success && !track.error.empty())
+            {
+                cout << "    Error: " << track.error << endl;
+            }
+            tracks_ok += track.success ? 1 : 0;
+            tracks_failed += track.success ? 0 : 1;
+            tracks_copied += track.success && track.copy ? 1 : 0;
+        }
+    }
+    dividing_line(100);
+    cout << fixed << setprecision(1) << tracks_ok << " track(s) extracted (" << tracks_copied << " copied without "
+         << "re-encoding), " << tracks_failed << " failed. Batch time " << batch_seconds << "s" << endl;
+    return tracks_failed == 0 ? 0 : 1;
+}
 /*
  *@brief 视频格式转换主函数
  *@return int 0表示成功，非0表示失败
@@ -104,6 +581,7 @@ int Converting_video_format()
     cin >> choice;
     if (choice == 2)
     {
+        return Converting_video_batch();
     }
     else
     {
@@ -139,7 +617,19 @@ int Converting_video_format()
             }
         }
 
-        string cmd = buildCmd(settings.getString("ffmpeg.path"), "-i", input_file_path, output_file_path);
+        // 先探测输入：编码能直接放进目标容器的流只复制不重新编码
+        ConvertJob job(input_file_path, output_file_path, settings.getString("ffmpeg.path"));
+        ConvertJob::ConvertPlan plan = job.plan();
+        string cmd;
+        for (const string &arg : plan.args)
+        {
+            cmd += (cmd.empty() ? "" : " ") + arg;
+        }
+        cout << "Strategy: " << ConvertJob::strategyName(plan.strategy) << endl;
+        if (!plan.note.empty())
+        {
+            cout << "Note: " << plan.note << endl;
+        }
         if (settings.getBool("isExecutionConfirmed"))
         {
             cout << "Executing command:" << cmd << endl
@@ -157,7 +647,15 @@ int Converting_video_format()
         // 执行命令
         FFmpegExecutor executor;
         executor.setAutoOverwrite(true);
-        FFmpegExecutor::ExecuteResult result = executor.execute(cmd);
+        executor.setCaptureOutput(settings.getBool("full_output"));
+        executor.setCgroupLimits(loadCgroupLimits());
+        // 直接以参数数组启动，路径中的空格无需加引号
+        ConvertJob::ConvertResult converted = job.run(executor, plan);
+        const FFmpegExecutor::ExecuteResult &result = converted.execution;
+        if (converted.retriedWithTranscode)
+        {
+            cout << "Note: " << converted.plan.note << endl;
+        }
         if (settings.getBool("full_output"))
         {
             cout << "Full output of ffmpeg command:" << endl;
@@ -168,7 +666,8 @@ int Converting_video_format()
 
         if (result.success)
         {
-            cout << "Video format conversion completed successfully." << endl;
+            cout << "Video format conversion completed successfully (" << ConvertJob::strategyName(converted.plan.strategy)
+                 << ", " << fixed << setprecision(1) << result.usage.wallSeconds << "s)." << endl;
         }
         else
         {
@@ -0,0 +1,612 @@
+/**
+ * libav_backend.h
+ * 进程内执行后端：直接调用libavformat完成封装转换/流复制，不启动FFmpeg进程
+ * 功能：接受与FFmpegExecutor相同的参数数组、进度回调和执行结果；能识别的流复制任务在本进程内执行，
+ *       进度和错误以结构化的回调报告，不经过日志文本；其余任务（需要编解码的转码、复杂参数、
+ *       以及未启用libav时的全部任务）原样交给内部的FFmpegExecutor运行
+ *
+ * 启用：编译时定义 CONVENIENT_CF_WITH_LIBAV，并链接 libavformat、libavcodec、libavutil，如
+ *     g++ -std=c++17 -DCONVENIENT_CF_WITH_LIBAV main.cpp $(pkg-config --cflags --libs libavformat libavcodec libavutil)
+ *
+ * 用法：
+ *     LibavBackend backend;
+ *     backend.setErrorCallback([](const LibavBackend::LibavError& e) { ... });
+ *     FFmpegExecutor::ExecuteResult r = backend.execute({"ffmpeg", "-y", "-i", "in.mkv", "-c", "copy", "out.mp4"});
+ */
+
+#ifndef LIBAV_BACKEND_H
+#define LIBAV_BACKEND_H
+
+#include "ffmpeg_executor.h"
+
+#include <filesystem>
+
+#ifdef CONVENIENT_CF_WITH_LIBAV
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/avutil.h>
+#include <libavutil/mathematics.h>
+}
+#endif
+
+class LibavBackend {
+public:
+    /**
+     * 进程内执行时的错误
+     */
+    struct LibavError {
+        int code = 0;               // libav返回的错误码（AVERROR），不是libav的错误时为0
+        std::string operation;      // 出错的调用，如 "avformat_open_input"
+        std::string message;        // 错误码的文字说明，以及libav在该调用期间输出的最后一条错误日志
+    };
+
+    // 错误回调（进程内执行出错时触发一次）
+    using ErrorCallback = std::function<void(const LibavError& error)>;
+
+    /**
+     * 从参数数组中识别出的流复制任务
+     */
+    struct RemuxPlan {
+        std::string input;
+        std::string output;
+        std::string format;                 // -f 指定的输出格式，空表示按扩展名推断
+        std::string movflags;               // -movflags 的值
+        int overwrite = -1;                 // -y 为1，-n 为0，未指定为-1（按setAutoOverwrite处理）
+        bool copy[3] = {false, false, false};       // 视频、音频、字幕是否指定为copy
+        bool disabled[3] = {false, false, false};   // -vn、-an、-sn
+        std::vector<std::string> maps;      // -map 的值，为空时与FFmpeg一样各取一路最佳的视频、音频、字幕
+    };
+
+    LibavBackend() = default;
+
+    LibavBackend(const LibavBackend&) = delete;
+    LibavBackend& operator=(const LibavBackend&) = delete;
+
+    /**
+     * 是否编译了进程内执行路径
+     * @return 定义了 CONVENIENT_CF_WITH_LIBAV 时为true
+     */
+    static bool available() {
+#ifdef CONVENIENT_CF_WITH_LIBAV
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * 获取回退用的执行器，用于设置超时、cgroup、行回调等只对FFmpeg进程有意义的选项
+     * @return 执行器
+     */
+    FFmpegExecutor& fallback() {
+        return fallback_;
+    }
+
+    /**
+     * 设置是否自动确认覆盖（两条执行路径都生效）
+     * @param auto_overwrite 是否自动确认
+     */
+    void setAutoOverwrite(bool auto_overwrite) {
+        auto_overwrite_ = auto_overwrite;
+        fallback_.setAutoOverwrite(auto_overwrite);
+    }
+
+    /**
+     * 设置进度回调（两条执行路径都生效）
+     * 进程内执行时每隔约0.5秒触发一次，结束时再触发一次finished为true的事件
+     * @param callback 回调函数
+     */
+    void setProgressCallback(FFmpegExecutor::ProgressCallback callback) {
+        progress_callback_ = callback;
+        fallback_.setProgressCallback(std::move(callback));
+    }
+
+    /**
+     * 设置进程内执行的错误回调
+     * @param callback 回调函数
+     */
+    void setErrorCallback(ErrorCallback callback) {
+        error_callback_ = std::move(callback);
+    }
+
+    /**
+     * 设置是否允许进程内执行，关闭后所有任务都交给FFmpeg进程
+     * @param enabled 是否允许
+     */
+    void setInProcess(bool enabled) {
+        in_process_ = enabled;
+    }
+
+    /**
+     * 执行任务：能识别的流复制任务在进程内执行，否则交给FFmpeg进程
+     * @param argv 与FFmpegExecutor::execute相同的参数数组，argv[0]为FFmpeg路径
+     * @return 执行结果，进程内执行时exitCode为0或1，usage只有wallSeconds
+     */
+    FFmpegExecutor::ExecuteResult execute(const std::vector<std::string>& argv) {
+        RemuxPlan plan;
+        bool handled = false;
+        FFmpegExecutor::ExecuteResult result = FFmpegExecutor::makeEmptyResult();
+        stop_requested_ = false;
+        if (in_process_ && available() && parseRemux(argv, plan)) {
+            result = remux(plan, handled);
+        }
+        if (!handled) {
+            last_in_process_ = false;
+            return fallback_.execute(argv);
+        }
+        last_in_process_ = true;
+        return result;
+    }
+
+    /**
+     * 上一个任务是否在进程内执行
+     * @return 是否在进程内执行
+     */
+    bool lastRunInProcess() const {
+        return last_in_process_;
+    }
+
+    /**
+     * 停止执行，可在其他线程调用，立即返回
+     * 进程内执行时在下一个数据包或阻塞的I/O处中止，已写出的部分仍会写好文件尾
+     */
+    void stop() {
+        stop_requested_ = true;
+        fallback_.stop();
+    }
+
+    /**
+     * 识别只做流复制的FFmpeg参数：单个输入、单个输出、所有选中的流都是copy
+     * 支持的选项：-y -n -hide_banner -nostdin -nostats -loglevel/-v -i -f -movflags
+     *             -c/-codec[:v|:a|:s] copy、-vcodec/-acodec/-scodec copy、-vn -an -sn、
+     *             -map 0[:v|:a|:s[:N]][?]；出现其他选项时返回false
+     * @param argv 参数数组
+     * @param plan 识别结果
+     * @return 是否为可在进程内执行的流复制任务（是否所有流都是copy要打开输入后才能确定）
+     */
+    static bool parseRemux(const std::vector<std::string>& argv, RemuxPlan& plan) {
+        if (argv.size() < 4 || !FFmpegExecutor::isFFmpegProgram(argv[0])) {
+            return false;
+        }
+        plan = RemuxPlan();
+        for (size_t i = 1; i < argv.size(); ++i) {
+            const std::string& arg = argv[i];
+            bool has_value = i + 1 < argv.size();
+            if (arg == "-y" || arg == "-n") {
+                plan.overwrite = arg == "-y";
+            } else if (arg == "-hide_banner" || arg == "-nostdin" || arg == "-nostats") {
+                continue;
+            } else if ((arg == "-loglevel" || arg == "-v") && has_value) {
+                ++i;
+            } else if (arg == "-i" && has_value && plan.input.empty()) {
+                plan.input = argv[++i];
+            } else if (arg == "-f" && has_value && !plan.input.empty()) {
+                plan.format = argv[++i];
+            } else if (arg == "-movflags" && has_value) {
+                plan.movflags = argv[++i];
+            } else if (arg == "-vn" || arg == "-an" || arg == "-sn") {
+                plan.disabled[mediaIndex(arg[1])] = true;
+            } else if (has_value && argv[i + 1] == "copy" && markCopy(arg, plan)) {
+                ++i;
+            } else if (arg == "-map" && has_value && isSupportedMap(argv[i + 1])) {
+                plan.maps.push_back(argv[++i]);
+            } else if (i + 1 == argv.size() && arg[0] != '-' && !plan.input.empty()) {
+                plan.output = arg;
+            } else {
+                return false;
+            }
+        }
+        return !plan.input.empty() && !plan.output.empty() && plan.input != "-" && plan.output != "-";
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // 进程内执行时两次进度回调的最小间隔
+    static constexpr double kProgressIntervalSeconds = 0.5;
+
+    FFmpegExecutor fallback_;
+    FFmpegExecutor::ProgressCallback progress_callback_;
+    ErrorCallback error_callback_;
+    bool auto_overwrite_ = true;
+    bool in_process_ = true;
+    bool last_in_process_ = false;
+    std::atomic<bool> stop_requested_{false};
+
+    /**
+     * 流类型字母对应的下标：v=0，a=1，s=2
+     */
+    static int mediaIndex(char type) {
+        return type == 'v' ? 0 : type == 'a' ? 1 : 2;
+    }
+
+    /**
+     * 识别 -c copy 一类的选项并记下对应的流类型
+     * @return 是否为支持的copy选项
+     */
+    static bool markCopy(const std::string& option, RemuxPlan& plan) {
+        if (option == "-c" || option == "-codec") {
+            plan.copy[0] = plan.copy[1] = plan.copy[2] = true;
+            return true;
+        }
+        for (std::string_view prefix : {"-c:", "-codec:"}) {
+            if (option.size() == prefix.size() + 1 && option.compare(0, prefix.size(), prefix) == 0 &&
+                std::strchr("vas", option.back()) != nullptr) {
+                plan.copy[mediaIndex(option.back())] = true;
+                return true;
+            }
+        }
+        if (option == "-vcodec" || option == "-acodec" || option == "-scodec") {
+            plan.copy[mediaIndex(option[1])] = true;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * 是否为支持的 -map 形式：0、0:v、0:a:1、0:s:0? 等
+     */
+    static bool isSupportedMap(std::string_view map) {
+        if (!map.empty() && map.back() == '?') {
+            map.remove_suffix(1);
+        }
+        if (map == "0") {
+            return true;
+        }
+        if (map.size() < 3 || map.compare(0, 2, "0:") != 0 || std::strchr("vas", map[2]) == nullptr) {
+            return false;
+        }
+        if (map.size() == 3) {
+            return true;
+        }
+        if (map.size() < 5 || map[3] != ':') {
+            return false;
+        }
+        int index = -1;
+        auto res = std::from_chars(map.data() + 4, map.data() + map.size(), index);
+        return res.ec == std::errc() && res.ptr == map.data() + map.size();
+    }
+
+    /**
+     * 报告一个错误：写入执行结果并触发错误回调
+     */
+    void fail(FFmpegExecutor::ExecuteResult& result, LibavError error, const std::string& log) {
+        if (!log.empty()) {
+            error.message += error.message.empty() ? log : " (" + log + ")";
+        }
+        result.success = false;
+        result.exitCode = 1;
+        result.error = error.operation.empty() ? error.message : error.operation + ": " + error.message;
+        if (error_callback_) {
+            error_callback_(error);
+        }
+    }
+
+#ifndef CONVENIENT_CF_WITH_LIBAV
+    /**
+     * 未启用libav时不在进程内执行
+     */
+    FFmpegExecutor::ExecuteResult remux(const RemuxPlan&, bool& handled) {
+        handled = false;
+        return FFmpegExecutor::makeEmptyResult();
+    }
+#else
+    /**
+     * 当前线程上正在进程内执行的任务收集到的最后一条错误日志
+     */
+    static std::string& threadLog() {
+        thread_local std::string log;
+        return log;
+    }
+
+    /**
+     * 替换libav默认的日志输出：错误级别的日志记到当前线程，其余丢弃，不再写到终端
+     * 只在第一次进程内执行时安装，影响整个进程的libav日志
+     */
+    static void installLogCallback() {
+        static std::once_flag once;
+        std::call_once(once, [] {
+            av_log_set_callback([](void*, int level, const char* format, va_list args) {
+                if (level > AV_LOG_ERROR) {
+                    return;
+                }
+                char text[1024];
+                std::vsnprintf(text, sizeof(text), format, args);
+                std::string& log = threadLog();
+                log = text;
+                while (!log.empty() && (log.back() == '\n' || log.back() == '\r')) {
+                    log.pop_back();
+                }
+            });
+        });
+    }
+
+    /**
+     * 构造libav调用失败的错误
+     */
+    static LibavError libavError(int code, const char* operation) {
+        char text[AV_ERROR_MAX_STRING_SIZE] = {0};
+        av_strerror(code, text, sizeof(text));
+        return LibavError{code, operation, text};
+    }
+
+    /**
+     * AVIO中断回调：stop()之后让阻塞的读写尽快返回
+     */
+    static int interruptCallback(void* opaque) {
+        return static_cast<LibavBackend*>(opaque)->stop_requested_.load() ? 1 : 0;
+    }
+
+    /**
+     * 按计划选出要复制的输入流
+     * @param copy_only 选中的流是否都指定了copy，否则有流需要转码，不能在进程内完成
+     * @return 输入流下标
+     */
+    static std::vector<int> selectStreams(const RemuxPlan& plan, AVFormatContext* input, bool& copy_only) {
+        static constexpr AVMediaType kTypes[] = {AVMEDIA_TYPE_VIDEO, AVMEDIA_TYPE_AUDIO, AVMEDIA_TYPE_SUBTITLE};
+        std::vector<int> streams;
+        auto type_index = [](AVMediaType type) {
+            return type == AVMEDIA_TYPE_VIDEO ? 0 : type == AVMEDIA_TYPE_AUDIO ? 1 : type == AVMEDIA_TYPE_SUBTITLE ? 2 : -1;
+        };
+        if (plan.maps.empty()) {
+            for (int t = 0; t < 3; ++t) {
+                if (plan.disabled[t]) {
+                    continue;
+                }
+                int index = av_find_best_stream(input, kTypes[t], -1, -1, nullptr, 0);
+                if (index >= 0) {
+                    streams.push_back(index);
+                }
+            }
+        } else {
+            for (std::string_view map : plan.maps) {
+                if (map.back() == '?') {
+                    map.remove_suffix(1);
+                }
+                int want_type = map.size() >= 3 ? mediaIndex(map[2]) : -1;
+                int want_nth = -1;
+                if (map.size() > 4) {
+                    std::from_chars(map.data() + 4, map.data() + map.size(), want_nth);
+                }
+                int nth = 0;
+                for (unsigned i = 0; i < input->nb_streams; ++i) {
+                    int t = type_index(input->streams[i]->codecpar->codec_type);
+                    if (want_type >= 0 && t != want_type) {
+                        continue;
+                    }
+                    if ((want_nth < 0 || nth == want_nth) &&
+                        std::find(streams.begin(), streams.end(), static_cast<int>(i)) == streams.end()) {
+                        streams.push_back(static_cast<int>(i));
+                    }
+                    nth++;
+                }
+            }
+            // -vn/-an/-sn 对 -map 选中的流同样生效
+            streams.erase(std::remove_if(streams.begin(), streams.end(), [&](int i) {
+                int t = type_index(input->streams[i]->codecpar->codec_type);
+                return t >= 0 && plan.disabled[t];
+            }), streams.end());
+        }
+        copy_only = true;
+        for (int i : streams) {
+            int t = type_index(input->streams[i]->codecpar->codec_type);
+            if (t < 0 || !plan.copy[t]) {
+                copy_only = false;
+            }
+        }
+        return streams;
+    }
+
+    /**
+     * 在进程内执行流复制，按 remux.c 的流程：打开输入 → 创建输出流并复制编码参数 → 写文件头 →
+     * 逐包换算时间基后交错写出 → 写文件尾
+     * @param plan 任务
+     * @param handled 是否在进程内处理了该任务；有流需要转码时为false，由调用方交给FFmpeg进程
+     * @return 执行结果
+     */
+    FFmpegExecutor::ExecuteResult remux(const RemuxPlan& plan, bool& handled) {
+        FFmpegExecutor::ExecuteResult result = FFmpegExecutor::makeEmptyResult();
+        handled = false;
+        installLogCallback();
+        threadLog().clear();
+        auto start = Clock::now();
+
+        AVFormatContext* input = avformat_alloc_context();
+        if (!input) {
+            return result;
+        }
+        input->interrupt_callback = AVIOInterruptCB{&LibavBackend::interruptCallback, this};
+        AVFormatContext* output = nullptr;
+        AVPacket* packet = nullptr;
+        bool header_written = false;
+
+        auto finish = [&] {
+            if (header_written) {
+                av_write_trailer(output);
+            }
+            if (output && !(output->oformat->flags & AVFMT_NOFILE)) {
+                avio_closep(&output->pb);
+            }
+            avformat_free_context(output);
+            avformat_close_input(&input);
+            av_packet_free(&packet);
+            result.usage.wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+            return result;
+        };
+
+        int ret = avformat_open_input(&input, plan.input.c_str(), nullptr, nullptr);
+        if (ret < 0) {
+            handled = true;
+            fail(result, libavError(ret, "avformat_open_input"), threadLog());
+            return finish();
+        }
+        if ((ret = avformat_find_stream_info(input, nullptr)) < 0) {
+            handled = true;
+            fail(result, libavError(ret, "avformat_find_stream_info"), threadLog());
+            return finish();
+        }
+        bool copy_only = false;
+        std::vector<int> streams = selectStreams(plan, input, copy_only);
+        if (!copy_only) {
+            return finish();
+        }
+        handled = true;
+        if (streams.empty()) {
+            fail(result, LibavError{0, "", "输入中没有可复制的流"}, "");
+            return finish();
+        }
+
+        // 与FFmpeg的覆盖提示一致：-y 直接覆盖，-n 不覆盖，未指定时按自动确认设置
+        std::error_code ec;
+        if (std::filesystem::exists(plan.output, ec)) {
+            result.overwritePrompted = plan.overwrite == -1;
+            bool overwrite = plan.overwrite == 1 || (plan.overwrite == -1 && auto_overwrite_);
+            result.overwriteConfirmed = result.overwritePrompted && overwrite;
+            if (!overwrite) {
+                fail(result, LibavError{0, "", "输出文件已存在，未覆盖: " + plan.output}, "");
+                return finish();
+            }
+        }
+
+        ret = avformat_alloc_output_context2(&output, nullptr, plan.format.empty() ? nullptr : plan.format.c_str(),
+                                             plan.output.c_str());
+        if (ret < 0 || !output) {
+            fail(result, libavError(ret < 0 ? ret : AVERROR_UNKNOWN, "avformat_alloc_output_context2"), threadLog());
+            return finish();
+        }
+        output->interrupt_callback = input->interrupt_callback;
+
+        // 输入流下标 → 输出流下标，不复制的流为-1
+        std::vector<int> stream_map(input->nb_streams, -1);
+        int video_out = -1;
+        for (int in_index : streams) {
+            AVStream* in_stream = input->streams[in_index];
+            AVStream* out_stream = avformat_new_stream(output, nullptr);
+            if (!out_stream) {
+                fail(result, libavError(AVERROR(ENOMEM), "avformat_new_stream"), "");
+                return finish();
+            }
+            if ((ret = avcodec_parameters_copy(out_stream->codecpar, in_stream->codecpar)) < 0) {
+                fail(result, libavError(ret, "avcodec_parameters_copy"), threadLog());
+                return finish();
+            }
+            // 不同容器的codec tag不通用，交给输出格式重新选择
+            out_stream->codecpar->codec_tag = 0;
+            stream_map[in_index] = out_stream->index;
+            if (video_out == -1 && in_stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+                video_out = out_stream->index;
+            }
+        }
+
+        if (!(output->oformat->flags & AVFMT_NOFILE)) {
+            ret = avio_open2(&output->pb, plan.output.c_str(), AVIO_FLAG_WRITE, &output->interrupt_callback, nullptr);
+            if (ret < 0) {
+                fail(result, libavError(ret, "avio_open2"), threadLog());
+                return finish();
+            }
+        }
+        AVDictionary* options = nullptr;
+        if (!plan.movflags.empty()) {
+            av_dict_set(&options, "movflags", plan.movflags.c_str(), 0);
+        }
+        ret = avformat_write_header(output, &options);
+        av_dict_free(&options);
+        if (ret < 0) {
+            fail(result, libavError(ret, "avformat_write_header"), threadLog());
+            return finish();
+        }
+        header_written = true;
+
+        packet = av_packet_alloc();
+        if (!packet) {
+            fail(result, libavError(AVERROR(ENOMEM), "av_packet_alloc"), "");
+            return finish();
+        }
+        const AVRational microseconds{1, AV_TIME_BASE};
+        long long duration_us = input->duration != AV_NOPTS_VALUE ? input->duration : -1;
+        long long start_us = input->start_time != AV_NOPTS_VALUE ? input->start_time : 0;
+        FFmpegExecutor::ProgressEvent progress;
+        progress.frame = 0;
+        double last_report = 0;
+
+        auto report = [&](bool finished) {
+            double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            progress.totalSize = output->pb ? avio_tell(output->pb) : -1;
+            if (progress.outTimeUs > 0 && elapsed > 0) {
+                progress.speed = progress.outTimeUs / 1e6 / elapsed;
+                progress.bitrateKbps = progress.totalSize * 8.0 / (progress.outTimeUs / 1e6) / 1000;
+            }
+            if (video_out != -1 && elapsed > 0) {
+                progress.fps = progress.frame / elapsed;
+            }
+            if (duration_us > 0 && progress.outTimeUs >= 0) {
+                long long done_us = std::min(progress.outTimeUs, duration_us);
+                progress.percent = done_us * 100.0 / duration_us;
+                if (progress.speed > 0) {
+                    progress.etaSeconds = (duration_us - done_us) / 1e6 / progress.speed;
+                }
+            }
+            progress.finished = finished;
+            last_report = elapsed;
+            if (progress_callback_) {
+                progress_callback_(progress);
+            }
+        };
+
+        while (!stop_requested_) {
+            if ((ret = av_read_frame(input, packet)) < 0) {
+                break;
+            }
+            int out_index = packet->stream_index < static_cast<int>(stream_map.size())
+                                ? stream_map[packet->stream_index] : -1;
+            if (out_index < 0) {
+                av_packet_unref(packet);
+                continue;
+            }
+            AVStream* in_stream = input->streams[packet->stream_index];
+            AVStream* out_stream = output->streams[out_index];
+            long long packet_us = packet->dts != AV_NOPTS_VALUE
+                                      ? av_rescale_q(packet->dts, in_stream->time_base, microseconds) - start_us : -1;
+            if (packet_us > progress.outTimeUs) {
+                progress.outTimeUs = packet_us;
+            }
+            if (out_index == video_out) {
+                progress.frame++;
+            }
+            av_packet_rescale_ts(packet, in_stream->time_base, out_stream->time_base);
+            packet->stream_index = out_index;
+            packet->pos = -1;
+            // 写出后packet已被清空，无需再unref
+            if ((ret = av_interleaved_write_frame(output, packet)) < 0) {
+                fail(result, libavError(ret, "av_interleaved_write_frame"), threadLog());
+                return finish();
+            }
+            if (progress_callback_ &&
+                std::chrono::duration<double>(Clock::now() - start).count() - last_report >= kProgressIntervalSeconds) {
+                report(false);
+            }
+        }
+        if (ret < 0 && ret != AVERROR_EOF && !stop_requested_) {
+            fail(result, libavError(ret, "av_read_frame"), threadLog());
+            return finish();
+        }
+
+        header_written = false;
+        if ((ret = av_write_trailer(output)) < 0) {
+            fail(result, libavError(ret, "av_write_trailer"), threadLog());
+            return finish();
+        }
+        if (stop_requested_) {
+            fail(result, LibavError{AVERROR_EXIT, "", "任务已取消"}, "");
+            return finish();
+        }
+        report(true);
+        result.success = true;
+        result.exitCode = 0;
+        return finish();
+    }
+#endif
+};
+
+#endif // LIBAV_BACKEND_H
@@ -96,7 +96,7 @@ int ffmpeg_tools()
         break;
     case 3:
         cout << "Extracting audio from video..." << endl;
-        // Add audio extraction functionality here
+        Extracting_audio();
         break;
     case 4:
         cout << "Merging videos..." << endl;
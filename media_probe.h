@@ -0,0 +1,354 @@
+/**
+ * media_probe.h
+ * 用ffprobe读取媒体文件的信息
+ * 功能：容器格式、时长、各路流的类型/编码/声道/语言；视频流的数据包时间和关键帧位置（只解封装不解码）；
+ *       视频帧数统计。ffprobe经由FFmpegExecutor以参数数组启动，只按行解析它的标准输出，不受输出保留上限影响；
+ *       标准错误（-v error 的诊断信息）单独收集，只用作错误信息，不会混进数据
+ */
+
+#ifndef MEDIA_PROBE_H
+#define MEDIA_PROBE_H
+
+#include "ffmpeg_executor.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+class MediaProbe {
+public:
+    /**
+     * 一路流的信息，未知的字段为-1或空
+     */
+    struct StreamInfo {
+        int index = -1;             // 流在文件中的编号
+        std::string type;           // video、audio、subtitle、data、attachment
+        std::string codec;          // 编码名，如 h264、aac
+        std::string profile;        // 编码档次，如 High、LC
+        int width = -1;
+        int height = -1;
+        int channels = -1;          // 音频声道数
+        int sampleRate = -1;        // 音频采样率
+        std::string language;       // 语言标签，如 eng
+        std::string title;          // 标题标签
+        bool attachedPicture = false;   // 是否为音频文件中的封面图
+    };
+
+    /**
+     * 文件的信息
+     */
+    struct MediaInfo {
+        std::string formatName;     // 容器格式，如 "mov,mp4,m4a,3gp,3g2,mj2"、"matroska,webm"
+        double durationSeconds = -1;
+        double startSeconds = 0;    // 容器的起始时间，-ss 等时间参数都相对于它
+        std::vector<StreamInfo> streams;
+
+        /**
+         * 统计某类流的数量
+         * @param type 流类型
+         * @return 数量
+         */
+        size_t count(const std::string& type) const {
+            return static_cast<size_t>(std::count_if(streams.begin(), streams.end(),
+                                                     [&](const StreamInfo& s) { return s.type == type; }));
+        }
+    };
+
+    /**
+     * 一个视频数据包的时间和是否为关键帧
+     */
+    struct PacketInfo {
+        double time = 0;            // 显示时间（秒），已减去容器的起始时间
+        bool keyframe = false;
+    };
+
+    /**
+     * 构造函数
+     * @param ffprobe ffprobe可执行文件路径
+     */
+    explicit MediaProbe(std::string ffprobe = "ffprobe") : ffprobe_(std::move(ffprobe)) {}
+
+    /**
+     * 由FFmpeg路径推出同目录下的ffprobe路径，如 "C:\ffmpeg\bin\ffmpeg.exe" → "C:\ffmpeg\bin\ffprobe.exe"
+     * @param ffmpeg FFmpeg可执行文件路径
+     * @return ffprobe路径，文件名中没有ffmpeg时返回 "ffprobe"
+     */
+    static std::string siblingOf(const std::string& ffmpeg) {
+        size_t name_start = ffmpeg.find_last_of("/\\");
+        name_start = name_start == std::string::npos ? 0 : name_start + 1;
+        size_t pos = ffmpeg.find("ffmpeg", name_start);
+        if (pos == std::string::npos) {
+            return "ffprobe";
+        }
+        return ffmpeg.substr(0, pos) + "ffprobe" + ffmpeg.substr(pos + 6);
+    }
+
+    /**
+     * 读取容器和各路流的信息
+     * @param path 文件路径
+     * @param info 读取结果
+     * @return 是否成功，失败原因见getLastError()
+     */
+    bool probe(const std::string& path, MediaInfo& info) {
+        info = MediaInfo();
+        std::string section;
+        bool ok = run({ffprobe_, "-v", "error", "-show_entries",
+                       "format=format_name,duration,start_time:stream=index,codec_type,codec_name,profile,width,height,"
+                       "channels,sample_rate:stream_tags=language,title:stream_disposition=attached_pic",
+                       "-of", "default", path},
+                      [&](std::string_view line) {
+            if (line.size() > 2 && line.front() == '[') {
+                section = std::string(line);
+                if (section == "[STREAM]") {
+                    info.streams.emplace_back();
+                }
+                return;
+            }
+            size_t equal_pos = line.find('=');
+            if (equal_pos == std::string_view::npos) {
+                return;
+            }
+            std::string_view key = line.substr(0, equal_pos);
+            std::string value(line.substr(equal_pos + 1));
+            if (value == "N/A" || value == "unknown") {
+                return;
+            }
+            if (section == "[FORMAT]") {
+                if (key == "format_name") {
+                    info.formatName = value;
+                } else if (key == "duration") {
+                    info.durationSeconds = std::atof(value.c_str());
+                } else if (key == "start_time") {
+                    info.startSeconds = std::atof(value.c_str());
+                }
+            } else if (section == "[STREAM]" && !info.streams.empty()) {
+                applyStreamField(key, value, info.streams.back());
+            }
+        });
+        if (ok && info.streams.empty() && info.formatName.empty()) {
+            last_error_ = "无法读取媒体信息: " + path;
+            return false;
+        }
+        return ok;
+    }
+
+    /**
+     * 读取第一路视频流所有数据包的时间和关键帧标记，只解封装不解码，长文件也很快
+     * @param path 文件路径
+     * @param start_seconds 容器的起始时间（probe()得到的startSeconds），从包时间中减去
+     * @param packets 按时间排序的数据包
+     * @return 是否成功
+     */
+    bool videoPackets(const std::string& path, double start_seconds, std::vector<PacketInfo>& packets) {
+        packets.clear();
+        bool ok = run({ffprobe_, "-v", "error", "-select_streams", "v:0", "-show_entries", "packet=pts_time,dts_time,flags",
+                       "-of", "csv=p=0", path},
+                      [&](std::string_view line) {
+            // pts_time,dts_time,flags，如 "12.345000,12.278000,K__"；没有pts时用dts
+            size_t first = line.find(',');
+            size_t second = first == std::string_view::npos ? first : line.find(',', first + 1);
+            if (second == std::string_view::npos) {
+                return;
+            }
+            std::string pts(line.substr(0, first));
+            std::string dts(line.substr(first + 1, second - first - 1));
+            const std::string& time = pts != "N/A" ? pts : dts;
+            if (time == "N/A" || time.empty()) {
+                return;
+            }
+            PacketInfo packet;
+            packet.time = std::atof(time.c_str()) - start_seconds;
+            packet.keyframe = second + 1 < line.size() && line[second + 1] == 'K';
+            packets.push_back(packet);
+        });
+        std::sort(packets.begin(), packets.end(),
+                  [](const PacketInfo& a, const PacketInfo& b) { return a.time < b.time; });
+        if (ok && packets.empty()) {
+            last_error_ = "没有视频数据包: " + path;
+            return false;
+        }
+        return ok;
+    }
+
+    /**
+     * 统计第一路视频流的帧数（数据包数，只解封装不解码）
+     * @param path 文件路径
+     * @return 帧数，失败时为-1
+     */
+    long long countVideoFrames(const std::string& path) {
+        long long frames = -1;
+        bool ok = run({ffprobe_, "-v", "error", "-select_streams", "v:0", "-count_packets", "-show_entries",
+                       "stream=nb_read_packets", "-of", "csv=p=0", path},
+                      [&](std::string_view line) {
+            long long value = -1;
+            auto res = std::from_chars(line.data(), line.data() + line.size(), value);
+            if (res.ec == std::errc() && frames < 0) {
+                frames = value;
+            }
+        });
+        return ok ? frames : -1;
+    }
+
+    /**
+     * 获取最后一条错误信息
+     * @return 错误信息
+     */
+    std::string getLastError() const {
+        return last_error_;
+    }
+
+private:
+    std::string ffprobe_;
+    std::string last_error_;
+
+    // 保留的标准错误的最大字节数
+    static constexpr size_t kMaxErrorBytes = 4096;
+
+    /**
+     * 运行ffprobe，把标准输出逐行交给回调；标准错误只记录下来，失败时作为错误信息
+     * FFmpegExecutor把子进程的标准输出和标准错误合并在一个管道里，ffprobe的诊断行（如
+     * "[mov,mp4 @ 0x..] stream 1, offset ..: partial file"）会被当成数据解析，因此标准输出另行读取：
+     * Unix下经setStdioRedirect接到独立的管道，Windows下用ffprobe的 -o 写到临时文件
+     * @return 是否成功
+     */
+    bool run(const std::vector<std::string>& argv, const FFmpegExecutor::LineCallback& on_line) {
+        std::string stderr_text;
+        FFmpegExecutor executor;
+        executor.setCaptureOutput(false);
+        executor.setLineCallback([&](std::string_view line) {
+            if (!line.empty() && stderr_text.size() < kMaxErrorBytes) {
+                stderr_text.append(stderr_text.empty() ? "" : "\n").append(line);
+            }
+        });
+        FFmpegExecutor::ExecuteResult result;
+#ifdef _WIN32
+        result = runToFile(executor, argv, on_line);
+#else
+        result = runToPipe(executor, argv, on_line);
+#endif
+        if (!result.success || result.exitCode != 0) {
+            last_error_ = !stderr_text.empty() ? stderr_text
+                          : !result.error.empty() ? result.error
+                          : "ffprobe退出码 " + std::to_string(result.exitCode);
+            return false;
+        }
+        last_error_.clear();
+        return true;
+    }
+
+    /**
+     * 把分帧器中的完整行交给回调
+     * @param finish 是否连同末尾没有换行符的半行一起交出
+     */
+    static void emitLines(LineFramer& framer, const FFmpegExecutor::LineCallback& on_line, bool finish) {
+        auto emit = [&](std::string_view line, bool) {
+            on_line(line);
+        };
+        framer.drain(emit);
+        if (finish) {
+            framer.finish(emit);
+        }
+    }
+
+#ifdef _WIN32
+    /**
+     * 让ffprobe用 -o 把结果写到临时文件，结束后逐行读取
+     */
+    FFmpegExecutor::ExecuteResult runToFile(FFmpegExecutor& executor, const std::vector<std::string>& argv,
+                                            const FFmpegExecutor::LineCallback& on_line) {
+        static std::atomic<unsigned> sequence{0};
+        std::error_code ec;
+        std::filesystem::path output = std::filesystem::temp_directory_path(ec) /
+            ("convenient_cf_probe_" + std::to_string(GetCurrentProcessId()) + "_" + std::to_string(sequence++) + ".txt");
+        std::vector<std::string> args = argv;
+        args.insert(args.begin() + 1, {"-o", output.u8string()});
+        FFmpegExecutor::ExecuteResult result = executor.execute(args);
+        std::ifstream file(output, std::ios::binary);
+        LineFramer framer;
+        char buffer[64 * 1024];
+        while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+            framer.append(buffer, static_cast<size_t>(file.gcount()));
+            emitLines(framer, on_line, false);
+        }
+        emitLines(framer, on_line, true);
+        file.close();
+        std::filesystem::remove(output, ec);
+        return result;
+    }
+#else
+    /**
+     * 把ffprobe的标准输出接到独立的管道上，由读取线程逐行交给回调，标准错误仍经执行器的行回调
+     */
+    static FFmpegExecutor::ExecuteResult runToPipe(FFmpegExecutor& executor, const std::vector<std::string>& argv,
+                                                   const FFmpegExecutor::LineCallback& on_line) {
+        int fds[2] = {-1, -1};
+#ifdef __linux__
+        bool piped = pipe2(fds, O_CLOEXEC) == 0;
+#else
+        bool piped = pipe(fds) == 0;
+        if (piped) {
+            fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+            fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        }
+#endif
+        if (!piped) {
+            FFmpegExecutor::ExecuteResult result = FFmpegExecutor::makeEmptyResult();
+            result.error = "创建管道失败: " + std::string(strerror(errno));
+            return result;
+        }
+        // 写端交给执行器，子进程启动后在父进程中关闭，子进程退出时读取线程读到EOF
+        executor.setStdioRedirect(-1, fds[1]);
+        std::thread reader([read_fd = fds[0], &on_line] {
+            LineFramer framer;
+            while (true) {
+                char* buffer = framer.writePtr();
+                ssize_t bytes_read = read(read_fd, buffer, framer.writeSpace());
+                if (bytes_read < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (bytes_read <= 0) {
+                    break;
+                }
+                framer.commit(static_cast<size_t>(bytes_read));
+                emitLines(framer, on_line, false);
+            }
+            emitLines(framer, on_line, true);
+        });
+        FFmpegExecutor::ExecuteResult result = executor.execute(argv);
+        reader.join();
+        close(fds[0]);
+        return result;
+    }
+#endif
+
+    /**
+     * 解析 [STREAM] 段中的一个字段
+     */
+    static void applyStreamField(std::string_view key, const std::string& value, StreamInfo& stream) {
+        if (key == "index") {
+            stream.index = std::atoi(value.c_str());
+        } else if (key == "codec_type") {
+            stream.type = value;
+        } else if (key == "codec_name") {
+            stream.codec = value;
+        } else if (key == "profile") {
+            stream.profile = value;
+        } else if (key == "width") {
+            stream.width = std::atoi(value.c_str());
+        } else if (key == "height") {
+            stream.height = std::atoi(value.c_str());
+        } else if (key == "channels") {
+            stream.channels = std::atoi(value.c_str());
+        } else if (key == "sample_rate") {
+            stream.sampleRate = std::atoi(value.c_str());
+        } else if (key == "TAG:language") {
+            stream.language = value;
+        } else if (key == "TAG:title") {
+            stream.title = value;
+        } else if (key == "DISPOSITION:attached_pic") {
+            stream.attachedPicture = value == "1";
+        }
+    }
+};
+
+#endif // MEDIA_PROBE_H